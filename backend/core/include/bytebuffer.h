@@ -0,0 +1,40 @@
+#pragma once
+#include "framework.h"
+
+/* Growable byte buffer for the binary data protocol. Data is appended in place to a string, which can then be moved into the crow response body
+	without copying. Reserving the expected size upfront makes a whole response a single allocation */
+class ByteBuffer
+{
+public:
+	ByteBuffer(size_t capacity = 0) { buffer.reserve(capacity); }
+
+	void reserve(size_t length) { buffer.reserve(buffer.size() + length); }
+	void write(const void *data, size_t length) { buffer.append(static_cast<const char *>(data), length); }
+	void write(const string &data) { buffer.append(data); }
+
+	/* Returns a pointer to length bytes at the end of the buffer, to be filled in place */
+	char *append(size_t length)
+	{
+		const size_t offset = buffer.size();
+		buffer.resize(offset + length);
+		return buffer.data() + offset;
+	}
+
+	template <typename T>
+	void write(const T &value)
+	{
+		static_assert(is_trivially_copyable<T>::value, "ByteBuffer can only write trivially copyable types");
+		write(&value, sizeof(T));
+	}
+
+	size_t size() const { return buffer.size(); }
+	const char *data() const { return buffer.data(); }
+	void clear() { buffer.clear(); }
+	void resize(size_t length) { buffer.resize(length); }
+
+	/* Moves the content out, leaving the buffer empty */
+	string release() { return std::move(buffer); }
+
+private:
+	string buffer;
+};
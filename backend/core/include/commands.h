@@ -98,13 +98,24 @@ public:
 	Command(function<void(void)> callback) : callback(callback) {};
 	unsigned int getPriority() { return priority; }
 	virtual string getString() = 0;
+	virtual string getName() = 0;
 	virtual unsigned int getLoad() = 0;
+	virtual string getSupersedeKey() { return ""; }	/* A queued command is replaced by a newer one with the same non empty key, see Scheduler::appendCommand. Only commands of the same type share a key */
 	const string getHash() { return hash; }
+	void setHash(string newHash) { hash = newHash; }
 	void executeCallback() { callback(); }
 
+	/* The callback of a superseded command runs when the command which replaced it runs, before its own one */
+	void inheritCallback(Command *superseded)
+	{
+		auto inherited = superseded->callback;
+		auto own = callback;
+		callback = [inherited, own]() { inherited(); own(); };
+	}
+
 protected:
 	unsigned int priority = CommandPriority::LOW;
-	const string hash = random_string(16);
+	string hash = random_string(16);
 	function<void(void)> callback;
 };
 
@@ -128,7 +139,9 @@ public:
 		priority = CommandPriority::MEDIUM; 
 	};
 	virtual string getString();
+	virtual string getName() { return "Move"; }
 	virtual unsigned int getLoad() { return onRoad? 45: 5; }
+	virtual string getSupersedeKey() { return "move/" + groupName; }
 
 private:
 	const string groupName;
@@ -154,6 +167,7 @@ public:
 		priority = CommandPriority::LOW; 
 	};
 	virtual string getString();
+	virtual string getName() { return "Smoke"; }
 	virtual unsigned int getLoad() { return 2; }
 
 private:
@@ -175,6 +189,7 @@ public:
 		priority = immediate? CommandPriority::IMMEDIATE: CommandPriority::LOW;
 	};
 	virtual string getString();
+	virtual string getName() { return "SpawnGroundUnits"; }
 	virtual unsigned int getLoad() { return immediate? 5: 30; }
 
 private:
@@ -198,6 +213,7 @@ public:
 		priority = immediate ? CommandPriority::IMMEDIATE : CommandPriority::LOW;
 	};
 	virtual string getString();
+	virtual string getName() { return "SpawnNavyUnits"; }
 	virtual unsigned int getLoad() { return immediate ? 5 : 60; }
 
 private:
@@ -222,6 +238,7 @@ public:
 		priority = immediate ? CommandPriority::IMMEDIATE : CommandPriority::LOW;
 	};
 	virtual string getString();
+	virtual string getName() { return "SpawnAircrafts"; }
 	virtual unsigned int getLoad() { return immediate ? 5 : 45; }
 
 private:
@@ -247,6 +264,7 @@ public:
 		priority = immediate ? CommandPriority::IMMEDIATE : CommandPriority::LOW;
 	};
 	virtual string getString();
+	virtual string getName() { return "SpawnHelicopters"; }
 	virtual unsigned int getLoad() { return immediate ? 5 : 45; }
 
 private:
@@ -269,6 +287,7 @@ public:
 		priority = CommandPriority::LOW;
 	};
 	virtual string getString();
+	virtual string getName() { return "Clone"; }
 	virtual unsigned int getLoad() { return 30; }
 
 private:
@@ -291,6 +310,7 @@ public:
 		immediate = immediate;
 	};
 	virtual string getString();
+	virtual string getName() { return "Delete"; }
 	virtual unsigned int getLoad() { return immediate? 1: 30; }
 
 private:
@@ -312,7 +332,9 @@ public:
 		priority = CommandPriority::MEDIUM;
 	};
 	virtual string getString();
+	virtual string getName() { return "SetTask"; }
 	virtual unsigned int getLoad() { return 5; }
+	virtual string getSupersedeKey() { return "task/" + groupName; }
 
 private:
 	const string groupName;
@@ -330,6 +352,7 @@ public:
 		priority = CommandPriority::HIGH;
 	};
 	virtual string getString();
+	virtual string getName() { return "ResetTask"; }
 	virtual unsigned int getLoad() { return 5; }
 
 private:
@@ -348,6 +371,7 @@ public:
 		priority = CommandPriority::HIGH;
 	};
 	virtual string getString();
+	virtual string getName() { return "SetCommand"; }
 	virtual unsigned int getLoad() { return 5; }
 
 private:
@@ -381,7 +405,9 @@ public:
 		priority = CommandPriority::HIGH;
 	};
 	virtual string getString();
+	virtual string getName() { return "SetOption"; }
 	virtual unsigned int getLoad() { return 5; }
+	virtual string getSupersedeKey() { return "option/" + groupName + "/" + to_string(optionID); }
 
 private:
 	const string groupName;
@@ -403,7 +429,9 @@ public:
 		priority = CommandPriority::HIGH;
 	};
 	virtual string getString();
+	virtual string getName() { return "SetOnOff"; }
 	virtual unsigned int getLoad() { return 5; }
+	virtual string getSupersedeKey() { return "onOff/" + groupName; }
 
 private:
 	const string groupName;
@@ -423,6 +451,7 @@ public:
 		priority = CommandPriority::MEDIUM;
 	};
 	virtual string getString();
+	virtual string getName() { return "Explosion"; }
 	virtual unsigned int getLoad() { return 5; }
 
 private:
@@ -0,0 +1,23 @@
+#pragma once
+#include "framework.h"
+
+enum class ContentEncoding { identity, deflate, zstd };
+
+ContentEncoding negotiateContentEncoding(const string &acceptEncoding);
+string getContentEncodingName(ContentEncoding encoding);
+bool compressBody(const string &data, ContentEncoding encoding, string &compressed);
+bool compressResponseBody(string &body, ContentEncoding encoding);
+
+/* Compressed bodies of a data endpoint for the current data version, by request key (see Server::create_data_response). Clients sending the same request
+	in the same tick get the same body, so they share a single serialization and compression pass. The cache is emptied as soon as the data version changes */
+class CompressedResponseCache
+{
+public:
+	bool get(unsigned long long version, const string &key, string &body);
+	void put(unsigned long long version, const string &key, const string &body);
+
+private:
+	mutex lock;
+	unsigned long long version = 0;
+	map<string, string> bodies;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include "framework.h"
+#include "datatypes.h"
+#include "bytebuffer.h"
+#include "utils.h"
+
+#include <memory>
+#include <atomic>
+
+/* Immutable copy of the data of a unit or weapon, taken at the end of a data tick. The serialized blocks of all the protocols are shared with the object
+	and with the previous snapshots, a block is only replaced, never modified, when its datum changes. A request is served by copying them, exactly as
+	Unit::getData would do from the live unit */
+struct ObjectSnapshot
+{
+	unsigned int ID = 0;
+	bool alive = false;
+	unsigned long long updateVersions[DataIndex::lastIndex] = {0};
+	unsigned long long lastUpdateVersion = 0;
+	unsigned long long visibilityVersions[3] = {0};
+	shared_ptr<const string> blocks[DataProtocol::lastProtocol][DataIndex::lastIndex];	/* Serialized [index][value] block of each datum and protocol */
+
+	/* Units only. The spatial index cells (see SpatialIndex::getCellKey) the unit was in when the last snapshots were published, newest first, with
+		the version of the snapshot in which it entered them. They tell which units may have entered or left an area since a reference version */
+	static const int cellHistorySize = 4;
+	struct CellChange
+	{
+		unsigned long long version = 0;
+		long long cell = 0;
+	};
+	enum CellLookup
+	{
+		cellUnknown,	/* Older than the history */
+		cellAbsent,		/* The unit did not exist yet */
+		cellKnown
+	};
+	Coords position;
+	CellChange cellHistory[cellHistorySize];
+	unsigned char cellHistoryCount = 0;
+	bool cellHistoryTruncated = false;
+
+	void getData(ByteBuffer &buffer, const DataRequest &request) const;
+	void setPosition(const Coords &newPosition, unsigned long long version, const ObjectSnapshot *previous);
+	long long getCell() const { return cellHistory[0].cell; }
+	CellLookup getCellAt(unsigned long long version, long long &cell) const;
+
+private:
+	void appendDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol) const;
+};
+
+/* Units and weapons data at the end of a data tick. A new snapshot is published after every tick under the global lock, and the REST handlers and the
+	data stream serialize from the latest one without taking the lock, area requests included. The snapshots of the objects which did not change are
+	shared with the previous one */
+struct DataSnapshot
+{
+	unsigned long long version = 0;
+	vector<shared_ptr<const ObjectSnapshot>> units;
+	vector<shared_ptr<const ObjectSnapshot>> weapons;
+	vector<bool> visibility[3];	/* See UnitsManager::updateVisibility */
+
+	void getUnitData(ByteBuffer &buffer, const DataRequest &request) const;
+	void getWeaponData(ByteBuffer &buffer, const DataRequest &request) const;
+	bool isVisible(unsigned int ID, unsigned char coalition) const;
+	static void appendRemovalNotice(ByteBuffer &buffer, unsigned int ID);
+
+	static void publish();
+	static void publish(shared_ptr<const DataSnapshot> snapshot);
+	static shared_ptr<const DataSnapshot> getLatest();
+	static void requestLeaderRefresh();
+
+private:
+	void appendUnitData(ByteBuffer &buffer, const ObjectSnapshot &unit, const DataRequest &request) const;
+	void appendAreaUnitData(ByteBuffer &buffer, const ObjectSnapshot &unit, const DataRequest &request) const;
+};
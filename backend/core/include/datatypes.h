@@ -51,6 +51,7 @@ namespace DataIndex {
 		shotsIntensity,
 		health,
 		lastIndex,
+		removed = 254,		/* Removal notice, for units which left the area of the request (see DataArea) or are no longer visible */
 		endOfData = 255
 	};
 }
@@ -101,6 +102,85 @@ namespace ShotsIntensity
 	};
 };
 
+/* Versions of the units and weapons binary protocol, requested with the protocol parameter. The version 2 quantizes the kinematic data,
+	see QuantizedCoords, quantizeSpeed and quantizeAngle */
+namespace DataProtocol
+{
+	enum DataProtocols
+	{
+		standard = 1,
+		quantized = 2,
+		lastProtocol = quantized
+	};
+};
+
+/* Area of a units data request, either a lat/lng box or a circle. The box of a circle contains the whole circle */
+struct DataArea
+{
+	bool enabled = false;
+	double minLat = 0;
+	double minLng = 0;
+	double maxLat = 0;
+	double maxLng = 0;
+	bool circle = false;
+	Coords center;
+	double radius = 0;
+
+	void setBox(double newMinLat, double newMinLng, double newMaxLat, double newMaxLng);
+	void setCircle(Coords newCenter, double newRadius);
+	bool contains(const Coords &position) const;
+	bool operator==(const DataArea &other) const;
+};
+
+/* Parameters of a units or weapons data request */
+struct DataRequest
+{
+	unsigned long long time = 0;						/* Reference data version, only the data updated after it is serialized */
+	unsigned char protocol = DataProtocol::standard;	/* See DataProtocol */
+	unsigned long long fields = ~0ULL;					/* Bitmask of the DataIndex values to serialize. The category and alive state are always sent */
+	DataArea area;										/* Only for units */
+	DataArea referenceArea;								/* Area of the request which returned the reference version. A delta is only computed against the same area, see DataSnapshot::appendAreaUnitData */
+	int coalition = -1;									/* Only the units visible to this coalition are sent, -1 for all the units */
+
+	bool isRequested(unsigned char datumIndex) const
+	{
+		return datumIndex == DataIndex::category || datumIndex == DataIndex::alive || ((fields >> datumIndex) & 1) != 0;
+	}
+};
+static_assert(DataIndex::lastIndex <= 64, "The DataRequest fields mask can only hold 64 data indexes");
+
+/* Layout of a unit record in the packed units data array (see Olympus.packedUnitsData in OlympusCommand.lua, the two must be kept in sync).
+	Each record is laid out as ID, N, followed by N fields. N = 0 means the unit no longer exists. Records truncated after isAlive are accepted,
+	and only update the kinematic data. Ammo and contacts are stored as a count followed by the flattened items */
+namespace PackedUnitField
+{
+	enum PackedUnitFields
+	{
+		category = 0,
+		name,
+		coalitionID,
+		lat,
+		lng,
+		alt,
+		heading,
+		track,
+		speed,
+		horizontalVelocity,
+		verticalVelocity,
+		isAlive,
+		unitName,
+		groupName,
+		isHuman,
+		hasTask,
+		fuel,
+		health,
+		ammoCount,
+		baseLength = unitName,
+		ammoItemLength = 5,		/* count, displayName, guidance, category, missileCategory */
+		contactItemLength = 2	/* ID, detectionMethod bitcode */
+	};
+};
+
 #pragma pack(push, 1)
 namespace DataTypes {
 	struct TACAN
@@ -139,6 +219,13 @@ namespace DataTypes {
 		unsigned int ID = 0;
 		unsigned char detectionMethod = 0;
 	};
+
+	/* Fixed point position: lat and lng in 1e-7 degrees, alt in cm */
+	struct QuantizedCoords {
+		int lat = 0;
+		int lng = 0;
+		int alt = 0;
+	};
 }
 #pragma pack(pop)
 
@@ -148,6 +235,17 @@ bool operator==(const DataTypes::GeneralSettings& lhs, const DataTypes::GeneralS
 bool operator==(const DataTypes::Ammo& lhs, const DataTypes::Ammo& rhs);
 bool operator==(const DataTypes::Contact& lhs, const DataTypes::Contact& rhs);
 
+/* Quantization of the protocol version 2. Rounding errors are at most 5e-8 degrees (0.6 cm) on lat and lng, 0.5 cm on the altitude, 0.05 m/s
+	on speeds and velocities (clamped to +-3276.7 m/s) and 4.8e-5 rad on angles (wrapped to [0, 2pi)) */
+DataTypes::QuantizedCoords quantizeCoords(const Coords& coords);
+short quantizeSpeed(double speed);
+unsigned short quantizeAngle(double angle);
+
+/* [index][value] blocks of the quantized kinematic data, as sent in the protocol version 2 (see Unit::serializeDatum) */
+void appendQuantizedCoords(string &block, unsigned char datumIndex, const Coords &coords);
+void appendQuantizedSpeed(string &block, unsigned char datumIndex, double speed);
+void appendQuantizedAngle(string &block, unsigned char datumIndex, double angle);
+
 struct SpawnOptions {
 	string unitType;
 	Coords location;
@@ -0,0 +1,33 @@
+#pragma once
+#include "framework.h"
+#include "utils.h"
+
+/* Bound of the local approximation: within GEODESY_MAX_APPROXIMATE_DISTANCE and below GEODESY_MAX_APPROXIMATE_LATITUDE, the approximated distance
+	differs from the WGS84 geodesic by less than GEODESY_RELATIVE_ERROR of the distance, plus GEODESY_ABSOLUTE_ERROR */
+#define GEODESY_RELATIVE_ERROR 0.01
+#define GEODESY_ABSOLUTE_ERROR 0.01					/* m */
+#define GEODESY_MAX_APPROXIMATE_DISTANCE 200000.0	/* m */
+#define GEODESY_MAX_APPROXIMATE_LATITUDE 75.0		/* degs */
+
+/* Local tangent plane around a reference point. The WGS84 radii of curvature are computed once for the reference, so that projecting a point
+	only requires a cosine. The plane is equirectangular at the mean latitude of the reference and the projected point */
+class LocalTangentPlane
+{
+public:
+	LocalTangentPlane(const Coords &reference);
+
+	void project(const Coords &point, double &east, double &north) const;
+	double getApproximateDistance(const Coords &point) const;
+	double getApproximateBearing(const Coords &point) const;
+	bool isApproximationValid(const Coords &point, double approximateDistance) const;
+	bool isWithinDistance(const Coords &point, double threshold) const;
+
+private:
+	Coords reference;
+	double meridionalRadius = 0;
+	double normalRadius = 0;
+};
+
+double approximateDistance(const Coords &a, const Coords &b);
+double geodesicDistance(const Coords &a, const Coords &b);
+bool isWithinDistance(const Coords &a, const Coords &b, double threshold);
@@ -0,0 +1,186 @@
+#pragma once
+#include "framework.h"
+#include "utils.h"
+#include "luatools.h"
+#include "datatypes.h"
+#include "defines.h"
+
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+
+/* Raw data of a unit, as captured from Lua on the simulation thread. A frame which is not full only flags that the unit no longer exists.
+	The controller fields (from unitName on) are only valid if hasControllerData is true */
+struct UnitFrame
+{
+	unsigned int ID = 0;
+	bool full = false;
+	string category;
+	string name;
+	unsigned char coalition = 0;
+	Coords position;
+	double heading = 0;
+	double track = 0;
+	double speed = 0;
+	double horizontalVelocity = 0;
+	double verticalVelocity = 0;
+	bool alive = false;
+	bool hasControllerData = false;
+	string unitName;
+	string groupName;
+	bool human = false;
+	bool hasTask = false;
+	double fuel = 0;
+	double health = 0;
+	vector<DataTypes::Ammo> ammo;
+	vector<DataTypes::Contact> contacts;
+
+	void read(lua_State *L, int index, unsigned int newID);
+	int readPacked(lua_State *L, int index, int cursor);
+	void inherit(const UnitFrame &older);
+};
+
+/* Raw data of a weapon, as captured from Lua on the simulation thread. A frame which is not full only flags that the weapon no longer exists */
+struct WeaponFrame
+{
+	unsigned int ID = 0;
+	bool full = false;
+	string category;
+	string name;
+	unsigned char coalition = 0;
+	Coords position;
+	double heading = 0;
+	double speed = 0;
+	bool alive = false;
+
+	void read(lua_State *L, int index, unsigned int newID);
+	void inherit(const WeaponFrame &older) {}
+};
+
+/* Frames captured in a single data tick. The frames are reused from one tick to the next, so that once the buffer is warmed up capturing does not allocate */
+template <typename T>
+struct FrameBuffer
+{
+	vector<T> frames;
+	size_t size = 0;
+	double dt = 0;
+
+	T &next()
+	{
+		if (size == frames.size())
+			frames.emplace_back();
+		return frames[size++];
+	}
+
+	void clear() { size = 0; }
+
+	/* Merges an older buffer into this one, with the same result as applying both in order. The older frames of the objects which also have a frame
+		in this buffer are dropped, so a merged buffer never holds more than one frame per object however many buffers it absorbed */
+	void merge(const FrameBuffer<T> &older)
+	{
+		unordered_map<unsigned int, size_t> newerFrames;
+		for (size_t i = 0; i < size; i++)
+			newerFrames[frames[i].ID] = i;
+
+		for (size_t i = 0; i < older.size; i++)
+		{
+			const T &olderFrame = older.frames[i];
+			auto newer = newerFrames.find(olderFrame.ID);
+			if (newer == newerFrames.end())
+				next() = olderFrame;
+			else
+				frames[newer->second].inherit(olderFrame);
+		}
+		dt += older.dt;
+	}
+};
+
+/* Decoding of the units and weapons data tables (see frames.cpp). They only read the Lua stack, so that they can run on the simulation thread */
+void readUnitsData(lua_State *L, int index, FrameBuffer<UnitFrame> &buffer);
+void readWeaponsData(lua_State *L, int index, FrameBuffer<WeaponFrame> &buffer);
+
+/* Two stage ingest pipeline for the units and weapons data. On the simulation thread, the Lua data is only copied into pre-allocated frame buffers.
+	A worker thread then applies the frames to the units and weapons under the global lock, and runs the AI loops. The commands generated by the AI
+	reach the simulation thread through the Scheduler queue, as for any other command */
+class Ingest
+{
+public:
+	Ingest(lua_State *L);
+	~Ingest();
+
+	void start();
+	void stop();
+
+	void captureUnits(lua_State *L, int index, double dt);
+	void captureWeapons(lua_State *L, int index, double dt);
+
+private:
+	thread worker;
+	mutex queueLock;
+	condition_variable queueCondition;
+	bool running = false;
+
+	deque<FrameBuffer<UnitFrame> *> pendingUnits;
+	deque<FrameBuffer<UnitFrame> *> freeUnits;
+	deque<FrameBuffer<WeaponFrame> *> pendingWeapons;
+	deque<FrameBuffer<WeaponFrame> *> freeWeapons;
+
+	void run();
+
+	template <typename T>
+	FrameBuffer<T> *acquireBuffer(deque<FrameBuffer<T> *> &freeBuffers)
+	{
+		FrameBuffer<T> *buffer = nullptr;
+		{
+			lock_guard<mutex> guard(queueLock);
+			if (!freeBuffers.empty())
+			{
+				buffer = freeBuffers.front();
+				freeBuffers.pop_front();
+			}
+		}
+
+		/* Only happens while warming up, or if the worker falls behind */
+		if (buffer == nullptr)
+			buffer = new FrameBuffer<T>();
+
+		buffer->clear();
+		return buffer;
+	}
+
+	/* Only queues the buffer, so that capturing stays a copy. The worker merges the buffers when it falls behind, see Ingest::run */
+	template <typename T>
+	void submitBuffer(deque<FrameBuffer<T> *> &pendingBuffers, FrameBuffer<T> *buffer)
+	{
+		{
+			lock_guard<mutex> guard(queueLock);
+			pendingBuffers.push_back(buffer);
+		}
+		queueCondition.notify_one();
+	}
+
+	/* Merges the oldest buffers into the following ones, so that at most INGEST_MAX_PENDING_BUFFERS are left. Runs on the worker thread without any
+		lock, the merged buffers are only returned to the free buffers with releaseBuffers */
+	template <typename T>
+	static void coalesceBuffers(deque<FrameBuffer<T> *> &buffers, deque<FrameBuffer<T> *> &released)
+	{
+		while (buffers.size() > INGEST_MAX_PENDING_BUFFERS)
+		{
+			FrameBuffer<T> *oldest = buffers.front();
+			buffers.pop_front();
+			buffers.front()->merge(*oldest);
+			released.push_back(oldest);
+		}
+	}
+
+	/* Called with queueLock held */
+	template <typename T>
+	static void releaseBuffers(deque<FrameBuffer<T> *> &released, deque<FrameBuffer<T> *> &freeBuffers)
+	{
+		freeBuffers.insert(freeBuffers.end(), released.begin(), released.end());
+		released.clear();
+	}
+
+	bool takePendingBuffers(deque<FrameBuffer<UnitFrame> *> &units, deque<FrameBuffer<WeaponFrame> *> &weapons, bool wait);
+};
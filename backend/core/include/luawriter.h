@@ -0,0 +1,55 @@
+#pragma once
+#include "framework.h"
+
+#include <charconv>
+#include <string_view>
+
+/* Builds the Lua source of the commands sent to DCS. Values are written one after the other and separated by commas, tables and "key = value" fields
+	are supported. Numbers are formatted with to_chars, in the shortest form which reads back to the same double, and strings are quoted and escaped.
+	Reserving the expected size upfront makes a whole command a single allocation */
+class LuaWriter
+{
+public:
+	LuaWriter(size_t capacity = 256) { buffer.reserve(capacity); }
+
+	/* Lua source written as is, e.g. a function name or a task table built by another writer */
+	LuaWriter &code(const string &source);
+	LuaWriter &value(double number);
+	LuaWriter &value(bool boolean);
+	LuaWriter &value(const string &text) { return quoted(text); }
+	LuaWriter &value(const char *text) { return quoted(text); }
+
+	template <typename T> requires is_integral_v<T> && (!is_same_v<T, bool>) && (!is_same_v<T, char>)
+	LuaWriter &value(T number)
+	{
+		separate();
+		char digits[24];
+		const auto result = to_chars(digits, digits + sizeof(digits), number);
+		buffer.append(digits, result.ptr);
+		return *this;
+	}
+
+	/* Starts a field, the next value is assigned to it */
+	LuaWriter &key(const char *name);
+	LuaWriter &beginTable();
+	LuaWriter &endTable();
+
+	size_t size() const { return buffer.size(); }
+	const string &str() const { return buffer; }
+	void clear() { buffer.clear(); separatorNeeded = false; }
+
+	/* Moves the content out, leaving the writer empty */
+	string release()
+	{
+		string source = std::move(buffer);
+		clear();
+		return source;
+	}
+
+private:
+	LuaWriter &quoted(string_view text);
+	void separate();
+
+	string buffer;
+	bool separatorNeeded = false;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include "framework.h"
+
+#include <atomic>
+
+/* Unbounded lock-free queue with many producers and a single consumer (Vyukov's algorithm). Producers only exchange the head pointer, so pushing never
+	blocks. An item being pushed becomes visible to the consumer once its producer has linked it, until then pop reports an empty queue */
+template <typename T>
+class MPSCQueue
+{
+public:
+	MPSCQueue()
+	{
+		Node *stub = new Node();
+		head.store(stub);
+		tail = stub;
+	}
+
+	~MPSCQueue()
+	{
+		T value;
+		while (pop(value));
+		delete tail;
+	}
+
+	MPSCQueue(const MPSCQueue &) = delete;
+	MPSCQueue &operator=(const MPSCQueue &) = delete;
+
+	/* Can be called by any thread */
+	void push(T value)
+	{
+		Node *node = new Node();
+		node->value = std::move(value);
+		Node *previous = head.exchange(node, memory_order_acq_rel);
+		previous->next.store(node, memory_order_release);
+	}
+
+	/* Must only be called by the consumer thread */
+	bool pop(T &value)
+	{
+		Node *next = tail->next.load(memory_order_acquire);
+		if (next == nullptr)
+			return false;
+
+		value = std::move(next->value);
+		delete tail;
+		tail = next;
+		return true;
+	}
+
+private:
+	struct Node
+	{
+		atomic<Node *> next = nullptr;
+		T value;
+	};
+
+	atomic<Node *> head;
+	Node *tail;
+};
@@ -2,6 +2,54 @@
 #include "framework.h"
 #include "luatools.h"
 #include "commands.h"
+#include "mpscqueue.h"
+#include "defines.h"
+
+#include <deque>
+#include <unordered_set>
+#include <unordered_map>
+#include <atomic>
+
+namespace CommandStatus {
+	enum CommandStatuses { UNKNOWN, PENDING, EXECUTED, FAILED, SUPERSEDED };
+};
+
+/* Client request, queued by the server and handled on the simulation thread. The hash is returned to the client as the command handle */
+struct PendingRequest
+{
+	string key;
+	json value;
+	string username;
+	string hash;
+};
+
+/* Command waiting in the scheduler queues. The Lua string is built once, and points into the set of the queued strings of its priority. The command
+	is null if it was superseded, see Scheduler::appendCommand */
+struct QueuedCommand
+{
+	Command *command;
+	const string *commandString;
+	string supersedeKey;
+};
+
+/* Execution cost of a command type, measured from the dostring_in timings, in microseconds per command */
+struct CommandCost
+{
+	double average = 0;				/* Exponentially weighted moving average */
+	double p95 = 0;					/* 95th percentile of the last SCHEDULER_COST_SAMPLES samples */
+	unsigned long long count = 0;	/* Number of executed commands */
+	deque<double> samples;
+
+	void addSample(double cost, unsigned int commandsCount);
+};
+
+/* Consecutive commands of the same type, executed as a single Lua chunk */
+struct CommandBatch
+{
+	string name;
+	string chunk;
+	vector<Command *> commands;
+};
 
 class Scheduler
 {
@@ -9,11 +57,16 @@ public:
 	Scheduler(lua_State* L);
 	~Scheduler();
 
-	void appendCommand(Command* command);
+	bool appendCommand(Command* command, string *queuedHash = nullptr);
 	void execute(lua_State* L);
-	void handleRequest(string key, json value, string username, json& answer);
+	string enqueueRequest(string key, json value, string username);
+	void handleRequests();
+	void handleRequest(string key, json value, string username, string hash);
 	bool checkSpawnPoints(int spawnPoints, string coalition);
-	bool isCommandExecuted(string commandHash) { return (find(executedCommandsHashes.begin(), executedCommandsHashes.end(), commandHash) != executedCommandsHashes.end()); }
+	double estimateCost(Command *command);
+	void setCommandExecuted(const string &commandHash);
+	void setCommandFailed(const string &commandHash);
+	int getCommandStatus(const string &requestHash);
 	
 	void setFrameRate(double newFrameRate) { frameRate = newFrameRate; }
 	void setRestrictSpawns(bool newRestrictSpawns) { restrictSpawns = newRestrictSpawns; }
@@ -25,7 +78,7 @@ public:
 	void setCommandModeOptions(json newOptions);
 
 	int getFrameRate() { return static_cast<int>(round(frameRate)); };
-	int getLoad();
+	int getLoad() { return queuedLoad; }
 	bool getRestrictSpawns() { return restrictSpawns; }
 	bool getRestrictToCoalition() { return restrictToCoalition; }
 	unsigned int getSetupTime() { return setupTime; }
@@ -33,13 +86,29 @@ public:
 	int getRedSpawnPoints() { return redSpawnPoints; }
 	vector<string> getEras() { return eras; }
 	json getCommandModeOptions();
+	json getCostStatistics();
 
 private:
-	list<Command*> commands;
-	list<string> executedCommandsHashes;
-	unsigned int load = 0;
-	double frameRate = 0;
+	deque<QueuedCommand> commands[CommandPriority::IMMEDIATE + 1];					/* FIFO queue of each priority */
+	unordered_map<string, string> queuedCommandsStrings[CommandPriority::IMMEDIATE + 1];	/* Strings of the queued commands of each priority, to discard the duplicates, with their hash */
+	atomic<int> queuedLoad = 0;														/* Sum of the loads of the queued commands. Atomic, since it is read by the REST handlers without the global lock */
+	unordered_map<string, QueuedCommand *> supersedableCommands[CommandPriority::IMMEDIATE + 1];	/* Queued commands of each priority, by supersede key */
+	unsigned long long supersededCommands = 0;										/* Number of commands replaced by a newer one before being executed */
+	unordered_set<string> queuedCommandsHashes;
+	unordered_map<string, int> finishedCommands;	/* Status of the last SCHEDULER_EXECUTED_HISTORY_SIZE executed or failed commands, by hash */
+	unordered_map<string, string> commandAliases;	/* Hashes of the requests discarded as duplicates, with the hash of the queued command they report the status of */
+	deque<string> finishedCommandsHistory;			/* Hashes of both, in order, to expire the oldest */
+	atomic<unsigned int> pendingRequests = 0;		/* Requests in the inbox, not handled yet */
+	MPSCQueue<PendingRequest> requests;
+	double executionDebt = 0;	/* Time spent over the execution budget by the previous batches, in microseconds */
+	double loadCost = SCHEDULER_INITIAL_LOAD_COST;	/* Moving average of the measured cost of a load unit, in microseconds */
+	map<string, CommandCost> costs;					/* Measured cost of each command type, by command name */
+	atomic<double> frameRate = 0;	/* Same as queuedLoad */
 	
+	void setCommandFinished(const string &commandHash, int status);
+	void setCommandAlias(const string &commandHash, const string &queuedHash);
+	void rememberCommand(const string &commandHash);
+
 	bool restrictSpawns = false;
 	bool restrictToCoalition = false;
 	unsigned int setupTime = 300;
@@ -11,6 +11,7 @@
                                     trigger.action.outText(\"Olympus critical error: \" ..retval, 20)\n \
                                 end\n \
                             end\n \
+                            return status\n \
                         end\n \
                         trigger.action.outText(\"Olympus.protectedCall registered successfully\", 10)\n"
 
@@ -5,10 +5,24 @@
 #include "crow/middlewares/cors.h"
 
 #include "server_middleware.h"
+#include "bytebuffer.h"
+#include "compression.h"
+#include "datatypes.h"
+#include "datasnapshot.h"
+
+#include <set>
+#include <atomic>
 
 class UnitsManager;
 class Scheduler;
 
+/* First byte of the messages of the data stream, followed by the same payload as the matching REST endpoint */
+enum DataStreamMessage
+{
+    units = 0,
+    weapons = 1
+};
+
 class Server
 {
 public:
@@ -16,10 +30,30 @@ public:
 
     void start(lua_State *L);
     void stop(lua_State *L);
+    void publishData();
 
 private:
     crow::App<LogMiddleware, crow::CORSHandler, AuthMiddleware, AuthRequiredMiddleware> app;
     std::future<void> serverJob;
+    atomic<size_t> unitsResponseSize = 0;
+    atomic<size_t> weaponsResponseSize = 0;
+    CompressedResponseCache unitsResponseCache;
+    CompressedResponseCache weaponsResponseCache;
+
+    /* Data stream subscribers. New subscribers get a full refresh on the next tick, then the deltas shared by the subscribers of the same coalition */
+    mutex streamLock;
+    set<crow::websocket::connection*> streamSubscribers;
+    set<crow::websocket::connection*> newStreamSubscribers;
+    unsigned long long lastPublishedVersion = 0;
+
+    /* Single use tokens to open the data stream, see handle_get_stream_token */
+    struct StreamToken
+    {
+        AuthRole role;
+        std::chrono::steady_clock::time_point expiry;
+    };
+    mutex streamTokensLock;
+    map<string, StreamToken> streamTokens;
 
     void initWebServer();
 
@@ -31,8 +65,17 @@ private:
     crow::response handle_get_bullseyes(const crow::request& req);
     crow::response handle_get_mission(const crow::request& req);
     crow::response handle_get_command(const crow::request& req);
+    crow::response handle_get_scheduler(const crow::request& req);
+    crow::response handle_get_stream_token(const crow::request& req);
 
     crow::response create_general_response(json& data, const std::chrono::milliseconds ms);
+    bool accept_stream(const crow::request& req, void** userdata);
+    int get_coalition(AuthRole role);
+    int get_stream_coalition(crow::websocket::connection* connection);
+    crow::response create_data_response(const crow::request& req, CompressedResponseCache& cache, atomic<size_t>& responseSize, const string& name, function<void(ByteBuffer&, const DataRequest&, const DataSnapshot&)> getData);
     crow::response handle_eptr(std::exception_ptr eptr);
     unsigned long long extract_reference_time(const crow::request& req);
+    unsigned char extract_protocol(const crow::request& req);
+    unsigned long long extract_fields(const crow::request& req);
+    DataArea extract_area(const crow::request& req, const char* bboxParam, const char* centerParam, const char* radiusParam);
 };
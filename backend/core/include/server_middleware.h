@@ -29,6 +29,7 @@ struct AuthMiddleware : crow::ILocalMiddleware
 
     void before_handle(crow::request& req, crow::response& res, context& ctx);
     void after_handle(crow::request& req, crow::response& res, context& ctx) {}
+    void authenticate(string authorization, context& ctx);
 };
 
 struct AuthRequiredMiddleware : crow::ILocalMiddleware
@@ -0,0 +1,55 @@
+#pragma once
+#include "framework.h"
+#include "utils.h"
+#include "datatypes.h"
+
+#include <unordered_map>
+
+#define SPATIAL_INDEX_CELL_SIZE 0.1		/* Size of the grid cells, in degrees of latitude and longitude */
+#define SPATIAL_INDEX_TOLERANCE 0.02	/* Relative error accepted on the approximated distances before falling back to the exact geodesic */
+
+class Unit;
+
+/* Uniform latitude/longitude grid of the alive units, partitioned by coalition and category. It answers nearest and range queries by only
+	visiting the cells around the query point, using an approximated distance to discard the candidates. The exact geodesic is only computed
+	on the final candidates. Longitude wrapping at the antimeridian is not handled, no DCS theatre crosses it */
+class SpatialIndex
+{
+public:
+	void update(Unit *unit);
+
+	Unit *getClosestUnit(Unit *unit, unsigned char coalition, const vector<string> &categories, double &distance);
+	map<Unit *, double> getUnitsInRange(Unit *unit, unsigned char coalition, const vector<string> &categories, double range);
+
+	/* The cells are also used to answer the area requests from the data snapshots, see ObjectSnapshot::cellHistory */
+	static int getCellIndex(double degrees) { return static_cast<int>(floor(degrees / SPATIAL_INDEX_CELL_SIZE)); }
+	static long long getCellKey(int latIndex, int lngIndex) { return (static_cast<long long>(latIndex) << 32) | static_cast<unsigned int>(lngIndex); }
+	static long long getCellKey(const Coords &position) { return getCellKey(getCellIndex(position.lat), getCellIndex(position.lng)); }
+	static bool isCellInArea(const DataArea &area, long long key);
+	static bool isCellOverlappingArea(const DataArea &area, long long key);
+
+private:
+	static const int coalitionsCount = 3;
+	static const int categoriesCount = 4;
+	static const int partitionsCount = coalitionsCount * categoriesCount;
+
+	struct Location
+	{
+		int partition = -1;
+		long long cell = 0;
+	};
+
+	unordered_map<long long, vector<Unit *>> cells[partitionsCount];
+	size_t sizes[partitionsCount] = {0};
+	unordered_map<Unit *, Location> locations;
+
+	static int getPartition(unsigned char coalition, const string &category);
+	static double getMinCellExtent(double lat, int rings);
+
+	vector<int> getPartitions(unsigned char coalition, const vector<string> &categories);
+	void removeFromCell(Unit *unit, const Location &location);
+	template <typename Visitor>
+	void visitCell(const vector<int> &partitions, int latIndex, int lngIndex, Visitor visitor);
+	template <typename Visitor>
+	void visitAll(const vector<int> &partitions, Visitor visitor);
+};
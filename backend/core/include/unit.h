@@ -6,6 +6,9 @@
 #include "logger.h"
 #include "commands.h"
 #include "datatypes.h"
+#include "bytebuffer.h"
+#include "ingest.h"
+#include "datasnapshot.h"
 
 #include <chrono>
 using namespace std::chrono;
@@ -20,15 +23,18 @@ public:
 
 	/********** Methods **********/
 	void initialize(json json);
+	void initialize(const UnitFrame &frame);
 	virtual void setDefaults(bool force = false);
 
 	void runAILoop();
 
 	void update(json json, double dt);
+	void update(const UnitFrame &frame, double dt);
 	void refreshLeaderData(unsigned long long time);
 
 	unsigned int getID() { return ID; }
-	void getData(stringstream &ss, unsigned long long time);
+	void getData(ByteBuffer &buffer, const DataRequest &request);
+	shared_ptr<const ObjectSnapshot> getSnapshot();
 	Coords getActiveDestination() { return activeDestination; }
 
 	virtual void changeSpeed(string change){};
@@ -60,22 +66,24 @@ public:
 	void triggerUpdate(unsigned char datumIndex);
 
 	bool hasFreshData(unsigned long long time);
+	unsigned long long getVisibilityVersion(unsigned char coalition) { return visibilityVersions[coalition]; }
+	void setVisibilityVersion(unsigned char coalition, unsigned long long version) { visibilityVersions[coalition] = version; }
 	bool checkFreshness(unsigned char datumIndex, unsigned long long time);
 
 	/********** Setters **********/
 	virtual void setCategory(string newValue) { updateValue(category, newValue, DataIndex::category); }
-	virtual void setAlive(bool newValue) { updateValue(alive, newValue, DataIndex::alive); }
+	virtual void setAlive(bool newValue);
 	virtual void setHuman(bool newValue) { updateValue(human, newValue, DataIndex::human); }
 	virtual void setControlled(bool newValue) { updateValue(controlled, newValue, DataIndex::controlled); }
-	virtual void setCoalition(unsigned char newValue) { updateValue(coalition, newValue, DataIndex::coalition); }
+	virtual void setCoalition(unsigned char newValue);
 	virtual void setCountry(unsigned char newValue) { updateValue(country, newValue, DataIndex::country); }
 	virtual void setName(string newValue) { updateValue(name, newValue, DataIndex::name); }
 	virtual void setUnitName(string newValue) { updateValue(unitName, newValue, DataIndex::unitName); }
-	virtual void setGroupName(string newValue) { updateValue(groupName, newValue, DataIndex::groupName); }
+	virtual void setGroupName(string newValue);
 	virtual void setState(unsigned char newValue) { updateValue(state, newValue, DataIndex::state); };
 	virtual void setTask(string newValue) { updateValue(task, newValue, DataIndex::task); }
 	virtual void setHasTask(bool newValue);
-	virtual void setPosition(Coords newValue) { updateValue(position, newValue, DataIndex::position); }
+	virtual void setPosition(Coords newValue);
 	virtual void setSpeed(double newValue) { updateValue(speed, newValue, DataIndex::speed); }
 	virtual void setHorizontalVelocity(double newValue) { updateValue(horizontalVelocity, newValue, DataIndex::horizontalVelocity); }
 	virtual void setVerticalVelocity(double newValue) { updateValue(verticalVelocity, newValue, DataIndex::verticalVelocity); }
@@ -212,19 +220,27 @@ protected:
 	Unit *missOnPurposeTarget = nullptr;
 	bool hasTaskAssigned = false;
 	double initialFuel = 0;
-	map<unsigned char, unsigned long long> updateTimeMap;
-	unsigned long long lastLoopTime = 0;
+	unsigned long long updateVersions[DataIndex::lastIndex] = {0};	/* Data version of the last update of each datum, indexed by DataIndex */
+	unsigned long long lastUpdateVersion = 0;							/* Max of updateVersions, to check for fresh data in O(1) */
+	unsigned long long lastLoopVersion = 0;
+	unsigned long long visibilityVersions[3] = {0};	/* Data version of the last visibility change for each coalition, see UnitsManager::updateVisibility */
+	shared_ptr<const string> serializedData[DataProtocol::lastProtocol][DataIndex::lastIndex];	/* Serialized [index][value] block of each datum and protocol, shared by all the requests and snapshots. Reset by triggerUpdate, the block is rebuilt when next requested */
+	shared_ptr<const ObjectSnapshot> snapshot;	/* Last snapshot of the unit, reused until the unit changes */
 	bool enableTaskFailedCheck = false;
 
 	/********** Private methods **********/
 	virtual void AIloop() = 0;
 
-	void appendString(stringstream &ss, const unsigned char &datumIndex, const string &datumValue)
+	void appendSerializedDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol);
+	const shared_ptr<const string> &getSerializedDatum(unsigned char datumIndex, unsigned char protocol);
+	void serializeDatum(string &block, unsigned char datumIndex, unsigned char protocol);
+
+	void appendString(string &block, const unsigned char &datumIndex, const string &datumValue)
 	{
 		const unsigned short size = static_cast<unsigned short>(datumValue.size());
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
-		ss << datumValue;
+		block.append((const char *)&datumIndex, sizeof(unsigned char));
+		block.append((const char *)&size, sizeof(unsigned short));
+		block.append(datumValue);
 	}
 
 	/********** Template methods **********/
@@ -239,32 +255,32 @@ protected:
 	}
 
 	template <typename T>
-	void appendNumeric(stringstream &ss, const unsigned char &datumIndex, T &datumValue)
+	void appendNumeric(string &block, const unsigned char &datumIndex, const T &datumValue)
 	{
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&datumValue, sizeof(T));
+		block.append((const char *)&datumIndex, sizeof(unsigned char));
+		block.append((const char *)&datumValue, sizeof(T));
 	}
 
 	template <typename T>
-	void appendVector(stringstream &ss, const unsigned char &datumIndex, vector<T> &datumValue)
+	void appendVector(string &block, const unsigned char &datumIndex, vector<T> &datumValue)
 	{
 		const unsigned short size = static_cast<unsigned short>(datumValue.size());
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
+		block.append((const char *)&datumIndex, sizeof(unsigned char));
+		block.append((const char *)&size, sizeof(unsigned short));
 
 		for (auto &el : datumValue)
-			ss.write((const char *)&el, sizeof(T));
+			block.append((const char *)&el, sizeof(T));
 	}
 
 	template <typename T>
-	void appendList(stringstream &ss, const unsigned char &datumIndex, list<T> &datumValue)
+	void appendList(string &block, const unsigned char &datumIndex, list<T> &datumValue)
 	{
 		const unsigned short size = static_cast<unsigned short>(datumValue.size());
 		;
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
+		block.append((const char *)&datumIndex, sizeof(unsigned char));
+		block.append((const char *)&size, sizeof(unsigned short));
 
 		for (auto &el : datumValue)
-			ss.write((const char *)&el, sizeof(T));
+			block.append((const char *)&el, sizeof(T));
 	}
 };
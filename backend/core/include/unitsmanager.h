@@ -1,6 +1,11 @@
 #pragma once
 #include "framework.h"
 #include "dcstools.h"
+#include "ingest.h"
+#include "spatialindex.h"
+#include "bytebuffer.h"
+
+#include <unordered_map>
 
 class Unit;
 
@@ -17,9 +22,16 @@ public:
 	Unit *getGroupLeader(unsigned int ID);
 	Unit *getGroupLeader(Unit *unit);
 	vector<Unit *> getGroupMembers(string groupName);
+	void onGroupNameChanged(Unit *unit, const string &oldGroupName);
+	void onAliveChanged(Unit *unit);
+	void updateSpatialIndex(Unit *unit);
 	void update(json &missionData, double dt);
+	void update(const FrameBuffer<UnitFrame> &buffer);
 	void runAILoop();
-	void getUnitData(stringstream &ss, unsigned long long time);
+	void updateVisibility();
+	bool isVisible(unsigned int ID, unsigned char coalition);
+	const vector<bool> &getVisibility(unsigned char coalition) { return visibility[coalition]; }
+	void getUnitData(ByteBuffer &buffer, const DataRequest &request);
 	void deleteUnit(unsigned int ID, bool explosion, string explosionType, bool immediate);
 	void acquireControl(unsigned int ID);
 	void loadDatabases();
@@ -29,4 +41,25 @@ public:
 private:
 	map<unsigned int, Unit *> units;
 	json missionDB;
+
+	/* Index of the units by group name, kept up to date when units are created, die or change group.
+		Members are sorted by ID, and the leader is the first alive member, which is the same rule as a scan of the units map */
+	struct GroupIndexEntry
+	{
+		vector<Unit *> members;
+		Unit *leader = nullptr;
+	};
+	unordered_map<string, GroupIndexEntry> groups;
+
+	/* Grid of the alive units, used by the closest unit and range queries */
+	SpatialIndex spatialIndex;
+
+	/* Units visible to the red and blue coalitions, indexed by unit ID. Rebuilt once per data tick by updateVisibility */
+	vector<bool> visibility[3];
+
+	Unit *createUnit(string category, json json, unsigned int ID);
+	void appendUnitData(ByteBuffer &buffer, Unit *unit, const DataRequest &request);
+	void addToGroup(Unit *unit);
+	void removeFromGroup(Unit *unit, const string &groupName);
+	void updateGroupLeader(GroupIndexEntry &group);
 };
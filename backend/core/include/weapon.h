@@ -6,6 +6,9 @@
 #include "logger.h"
 #include "commands.h"
 #include "datatypes.h"
+#include "bytebuffer.h"
+#include "ingest.h"
+#include "datasnapshot.h"
 
 #include <chrono>
 using namespace std::chrono;
@@ -18,9 +21,12 @@ public:
 
 	/********** Methods **********/
 	void initialize(json json);
+	void initialize(const WeaponFrame &frame);
 	void update(json json, double dt);
+	void update(const WeaponFrame &frame, double dt);
 	unsigned int getID() { return ID; }
-	void getData(stringstream &ss, unsigned long long time);
+	void getData(ByteBuffer &buffer, const DataRequest &request);
+	shared_ptr<const ObjectSnapshot> getSnapshot();
 	void triggerUpdate(unsigned char datumIndex);
 	bool hasFreshData(unsigned long long time);
 	bool checkFreshness(unsigned char datumIndex, unsigned long long time);
@@ -55,15 +61,19 @@ protected:
 	double heading = NULL;
 
 	/********** Other **********/
-	map<unsigned char, unsigned long long> updateTimeMap;
+	unsigned long long updateVersions[DataIndex::lastIndex] = {0};	/* Data version of the last update of each datum, indexed by DataIndex */
+	unsigned long long lastUpdateVersion = 0;							/* Max of updateVersions, to check for fresh data in O(1) */
+	shared_ptr<const ObjectSnapshot> snapshot;	/* Last snapshot of the weapon, reused until the weapon changes */
 
 	/********** Private methods **********/
-	void appendString(stringstream &ss, const unsigned char &datumIndex, const string &datumValue)
+	void serializeDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol);
+
+	void appendString(ByteBuffer &buffer, const unsigned char &datumIndex, const string &datumValue)
 	{
 		const unsigned short size = static_cast<unsigned short>(datumValue.size());
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
-		ss << datumValue;
+		buffer.write(datumIndex);
+		buffer.write(size);
+		buffer.write(datumValue);
 	}
 
 	/********** Template methods **********/
@@ -78,32 +88,32 @@ protected:
 	}
 
 	template <typename T>
-	void appendNumeric(stringstream &ss, const unsigned char &datumIndex, T &datumValue)
+	void appendNumeric(ByteBuffer &buffer, const unsigned char &datumIndex, const T &datumValue)
 	{
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&datumValue, sizeof(T));
+		buffer.write(datumIndex);
+		buffer.write(&datumValue, sizeof(T));
 	}
 
 	template <typename T>
-	void appendVector(stringstream &ss, const unsigned char &datumIndex, vector<T> &datumValue)
+	void appendVector(ByteBuffer &buffer, const unsigned char &datumIndex, vector<T> &datumValue)
 	{
 		const unsigned short size = datumValue.size();
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
+		buffer.write(datumIndex);
+		buffer.write(size);
 
 		for (auto &el : datumValue)
-			ss.write((const char *)&el, sizeof(T));
+			buffer.write(&el, sizeof(T));
 	}
 
 	template <typename T>
-	void appendList(stringstream &ss, const unsigned char &datumIndex, list<T> &datumValue)
+	void appendList(ByteBuffer &buffer, const unsigned char &datumIndex, list<T> &datumValue)
 	{
 		const unsigned short size = datumValue.size();
-		ss.write((const char *)&datumIndex, sizeof(unsigned char));
-		ss.write((const char *)&size, sizeof(unsigned short));
+		buffer.write(datumIndex);
+		buffer.write(size);
 
 		for (auto &el : datumValue)
-			ss.write((const char *)&el, sizeof(T));
+			buffer.write(&el, sizeof(T));
 	}
 };
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "framework.h"
 #include "dcstools.h"
+#include "ingest.h"
+#include "bytebuffer.h"
 
 class Weapon;
 
@@ -13,7 +15,8 @@ public:
 	map<unsigned int, Weapon *> &getWeapons() { return weapons; };
 	Weapon *getWeapon(unsigned int ID);
 	void update(json &missionData, double dt);
-	void getWeaponData(stringstream &ss, unsigned long long time);
+	void update(const FrameBuffer<WeaponFrame> &buffer);
+	void getWeaponData(ByteBuffer &buffer, const DataRequest &request);
 
 private:
 	map<unsigned int, Weapon *> weapons;
@@ -2,6 +2,7 @@
 #include "utils.h"
 #include "logger.h"
 #include "commands.h"
+#include "luawriter.h"
 #include "scheduler.h"
 #include "defines.h"
 #include "unitsManager.h"
@@ -188,20 +189,27 @@ void AirUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			if (isActiveTanker)
+			LuaWriter taskWriter;
+			if (isActiveTanker || isActiveAWACS)
 			{
-				taskSS << "{ [1] = { id = 'Tanker' }, [2] = { id = 'Orbit', pattern = 'Race-Track', altitude = " << desiredAltitude << ", speed = " << desiredSpeed << ", altitudeType = '" << (desiredAltitudeType ? "AGL" : "ASL") << "', speedType = '" << (desiredSpeedType ? "GS" : "CAS") << "' }}";
-			}
-			else if (isActiveAWACS)
-			{
-				taskSS << "{ [1] = { id = 'AWACS' }, [2] = { id = 'Orbit', pattern = 'Circle', altitude = " << desiredAltitude << ", speed = " << desiredSpeed << ", altitudeType = '" << (desiredAltitudeType ? "AGL" : "ASL") << "', speedType = '" << (desiredSpeedType ? "GS" : "CAS") << "' }}";
+				taskWriter.beginTable()
+					.beginTable().key("id").value(isActiveTanker ? "Tanker" : "AWACS").endTable()
+					.beginTable();
 			}
 			else
-			{
-				taskSS << "{ id = 'Orbit', pattern = 'Circle', altitude = " << desiredAltitude << ", speed = " << desiredSpeed << ", altitudeType = '" << (desiredAltitudeType ? "AGL" : "ASL") << "', speedType = '" << (desiredSpeedType ? "GS" : "CAS") << "'}";
-			}
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				taskWriter.beginTable();
+
+			taskWriter.key("id").value("Orbit")
+				.key("pattern").value(isActiveTanker ? "Race-Track" : "Circle")
+				.key("altitude").value(desiredAltitude)
+				.key("speed").value(desiredSpeed)
+				.key("altitudeType").value(desiredAltitudeType ? "AGL" : "ASL")
+				.key("speedType").value(desiredSpeedType ? "GS" : "CAS")
+				.endTable();
+
+			if (isActiveTanker || isActiveAWACS)
+				taskWriter.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -271,13 +279,12 @@ void AirUnit::AIloop()
 
 		/* Attack state is an "enroute" task, meaning the unit will keep trying to attack even if a new destination is set. This is useful to
 		   manoeuvre the unit so that it can detect and engage the target. */
-		std::ostringstream enrouteTaskSS;
-		enrouteTaskSS << "{"
-					  << "id = 'EngageUnit'"
-					  << ","
-					  << "targetID = " << targetID << ","
-					  << "}";
-		string enrouteTask = enrouteTaskSS.str();
+		LuaWriter enrouteTaskWriter;
+		enrouteTaskWriter.beginTable()
+			.key("id").value("EngageUnit")
+			.key("targetID").value(targetID)
+			.endTable();
+		string enrouteTask = enrouteTaskWriter.release();
 		setTask("Attacking " + getTargetName());
 
 		if (!getHasTask())
@@ -307,18 +314,17 @@ void AirUnit::AIloop()
 		{
 			if (leader != nullptr && leader->getAlive() && formationOffset != NULL)
 			{
-				std::ostringstream taskSS;
-				taskSS << "{"
-					   << "id = 'FollowUnit'"
-					   << ", "
-					   << "leaderID = " << leader->getID() << ","
-					   << "offset = {"
-					   << "x = " << formationOffset.x << ","
-					   << "y = " << formationOffset.y << ","
-					   << "z = " << formationOffset.z
-					   << "},"
-					   << "}";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable()
+					.key("id").value("FollowUnit")
+					.key("leaderID").value(leader->getID())
+					.key("offset").beginTable()
+					.key("x").value(formationOffset.x)
+					.key("y").value(formationOffset.y)
+					.key("z").value(formationOffset.z)
+					.endTable()
+					.endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -334,11 +340,9 @@ void AirUnit::AIloop()
 		{
 			if (fuel <= initialFuel)
 			{
-				std::ostringstream taskSS;
-				taskSS << "{"
-					   << "id = 'Refuel'"
-					   << "}";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable().key("id").value("Refuel").endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -356,11 +360,13 @@ void AirUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			taskSS.precision(10);
-
-			taskSS << "{id = 'Bombing', lat = " << targetPosition.lat << ", lng = " << targetPosition.lng << "}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("Bombing")
+				.key("lat").value(targetPosition.lat)
+				.key("lng").value(targetPosition.lng)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -373,11 +379,13 @@ void AirUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			taskSS.precision(10);
-
-			taskSS << "{id = 'CarpetBombing', lat = " << targetPosition.lat << ", lng = " << targetPosition.lng << "}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("CarpetBombing")
+				.key("lat").value(targetPosition.lat)
+				.key("lng").value(targetPosition.lng)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -390,11 +398,13 @@ void AirUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			taskSS.precision(10);
-
-			taskSS << "{id = 'AttackMapObject', lat = " << targetPosition.lat << ", lng = " << targetPosition.lng << "}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("AttackMapObject")
+				.key("lat").value(targetPosition.lat)
+				.key("lng").value(targetPosition.lng)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -408,14 +418,13 @@ void AirUnit::AIloop()
 		if (!getHasTask())
 		{
 			setActiveDestination();
-			std::ostringstream taskSS;
-			taskSS.precision(10),
-				taskSS << "{"
-					   << "id = 'LandAtPoint', "
-					   << "lat = " << activeDestination.lat << ", "
-					   << "lng = " << activeDestination.lng
-					   << "}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("LandAtPoint")
+				.key("lat").value(activeDestination.lat)
+				.key("lng").value(activeDestination.lng)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -3,254 +3,223 @@
 #include "dcstools.h"
 #include "unit.h"
 #include "unitsmanager.h"
+#include "luawriter.h"
 
 extern UnitsManager* unitsManager;
 
 /* Move command */
 string Move::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.move, "
-        << "\"" << groupName << "\"" << ", "
-        << destination.lat << ", "
-        << destination.lng << ", "
-        << altitude << ", "
-        << "\"" << altitudeType << "\"" << ", "
-        << speed << ", "
-        << "\"" << speedType << "\"" << ", "
-        << "\"" << category << "\"" << ", "
-        << taskOptions;
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.move")
+        .value(groupName)
+        .value(destination.lat)
+        .value(destination.lng)
+        .value(altitude)
+        .value(altitudeType)
+        .value(speed)
+        .value(speedType)
+        .value(category)
+        .code(taskOptions);
+    return writer.release();
 }
 
 /* Smoke command */
 string Smoke::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.smoke, " 
-        << "\"" << color << "\"" << ", "
-        << location.lat << ", "
-        << location.lng;
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.smoke")
+        .value(color)
+        .value(location.lat)
+        .value(location.lng);
+    return writer.release();
 }
 
 /* Spawn ground units command */
 string SpawnGroundUnits::getString()
 {
-    std::ostringstream unitsSS;
-    unitsSS.precision(10);
-    for (int i = 0; i < spawnOptions.size(); i++) {
-        unitsSS << "[" << i + 1 << "] = {" 
-            << "unitType = " << "\"" << spawnOptions[i].unitType << "\"" << ", "
-            << "lat = " << spawnOptions[i].location.lat << ", "
-            << "lng = " << spawnOptions[i].location.lng << ", "
-            << "liveryID = " << "\"" << spawnOptions[i].liveryID << "\"" << ", "
-            << "skill =  \"" << spawnOptions[i].skill << "\"" << "}, ";
-
+    LuaWriter writer(256 + 128 * spawnOptions.size());
+    writer.code("Olympus.spawnUnits").beginTable()
+        .key("category").value("GroundUnit")
+        .key("coalition").value(coalition)
+        .key("country").value(country)
+        .key("units").beginTable();
+    for (auto const &options : spawnOptions) {
+        writer.beginTable()
+            .key("unitType").value(options.unitType)
+            .key("lat").value(options.location.lat)
+            .key("lng").value(options.location.lng)
+            .key("liveryID").value(options.liveryID)
+            .key("skill").value(options.skill)
+            .endTable();
     }
-
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.spawnUnits, {"
-        << "category = " << "\"" << "GroundUnit" << "\"" << ", "
-        << "coalition = " << "\"" << coalition << "\"" << ", "
-        << "country = \"" << country << "\", "
-        << "units = " << "{" << unitsSS.str() << "}" << "}";
-    return commandSS.str();
+    writer.endTable().endTable();
+    return writer.release();
 }
 
 
 /* Spawn ground units command */
 string SpawnNavyUnits::getString()
 {
-    std::ostringstream unitsSS;
-    unitsSS.precision(10);
-    for (int i = 0; i < spawnOptions.size(); i++) {
-        unitsSS << "[" << i + 1 << "] = {"
-            << "unitType = " << "\"" << spawnOptions[i].unitType << "\"" << ", "
-            << "lat = " << spawnOptions[i].location.lat << ", "
-            << "lng = " << spawnOptions[i].location.lng << ", "
-            << "liveryID = " << "\"" << spawnOptions[i].liveryID << "\"" << ", "
-            << "skill =  \"" << spawnOptions[i].skill << "\"" << "}, ";
+    LuaWriter writer(256 + 128 * spawnOptions.size());
+    writer.code("Olympus.spawnUnits").beginTable()
+        .key("category").value("NavyUnit")
+        .key("coalition").value(coalition)
+        .key("country").value(country)
+        .key("units").beginTable();
+    for (auto const &options : spawnOptions) {
+        writer.beginTable()
+            .key("unitType").value(options.unitType)
+            .key("lat").value(options.location.lat)
+            .key("lng").value(options.location.lng)
+            .key("liveryID").value(options.liveryID)
+            .key("skill").value(options.skill)
+            .endTable();
     }
-
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.spawnUnits, {"
-        << "category = " << "\"" << "NavyUnit" << "\"" << ", "
-        << "coalition = " << "\"" << coalition << "\"" << ", "
-        << "country = \"" << country << "\", "
-        << "units = " << "{" << unitsSS.str() << "}" << "}";
-    return commandSS.str();
+    writer.endTable().endTable();
+    return writer.release();
 }
 
 /* Spawn aircrafts command */
 string SpawnAircrafts::getString()
 {
-    std::ostringstream unitsSS;
-    unitsSS.precision(10);
-    for (int i = 0; i < spawnOptions.size(); i++) {
-        unitsSS << "[" << i + 1 << "] = {"
-            << "unitType = " << "\"" << spawnOptions[i].unitType << "\"" << ", "
-            << "lat = " << spawnOptions[i].location.lat << ", "
-            << "lng = " << spawnOptions[i].location.lng << ", "
-            << "alt = " << spawnOptions[i].location.alt << ", "
-            << "loadout = \"" << spawnOptions[i].loadout << "\"" << ", "
-            << "liveryID = " << "\"" << spawnOptions[i].liveryID << "\"" << ", "
-            << "skill =  \"" << spawnOptions[i].skill << "\"" << "}, ";
+    LuaWriter writer(256 + 192 * spawnOptions.size());
+    writer.code("Olympus.spawnUnits").beginTable()
+        .key("category").value("Aircraft")
+        .key("coalition").value(coalition)
+        .key("airbaseName").value(airbaseName)
+        .key("country").value(country)
+        .key("units").beginTable();
+    for (auto const &options : spawnOptions) {
+        writer.beginTable()
+            .key("unitType").value(options.unitType)
+            .key("lat").value(options.location.lat)
+            .key("lng").value(options.location.lng)
+            .key("alt").value(options.location.alt)
+            .key("loadout").value(options.loadout)
+            .key("liveryID").value(options.liveryID)
+            .key("skill").value(options.skill)
+            .endTable();
     }
-
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.spawnUnits, {" 
-        << "category = " << "\"" << "Aircraft" << "\"" << ", "
-        << "coalition = " << "\"" << coalition << "\"" << ", "
-        << "airbaseName = \"" << airbaseName << "\", "
-        << "country = \"" << country << "\", "
-        << "units = " << "{" << unitsSS.str() << "}" << "}";
-    return commandSS.str();
+    writer.endTable().endTable();
+    return writer.release();
 }
 
 
 /* Spawn helicopters command */
 string SpawnHelicopters::getString()
 {
-    std::ostringstream unitsSS;
-    unitsSS.precision(10);
-    for (int i = 0; i < spawnOptions.size(); i++) {
-        unitsSS << "[" << i + 1 << "] = {"
-            << "unitType = " << "\"" << spawnOptions[i].unitType << "\"" << ", "
-            << "lat = " << spawnOptions[i].location.lat << ", "
-            << "lng = " << spawnOptions[i].location.lng << ", "
-            << "alt = " << spawnOptions[i].location.alt << ", "
-            << "loadout = \"" << spawnOptions[i].loadout << "\"" << ", "
-            << "liveryID = " << "\"" << spawnOptions[i].liveryID << "\"" << ", "
-            << "skill =  \"" << spawnOptions[i].skill << "\"" << "}, ";
+    LuaWriter writer(256 + 192 * spawnOptions.size());
+    writer.code("Olympus.spawnUnits").beginTable()
+        .key("category").value("Helicopter")
+        .key("coalition").value(coalition)
+        .key("airbaseName").value(airbaseName)
+        .key("country").value(country)
+        .key("units").beginTable();
+    for (auto const &options : spawnOptions) {
+        writer.beginTable()
+            .key("unitType").value(options.unitType)
+            .key("lat").value(options.location.lat)
+            .key("lng").value(options.location.lng)
+            .key("alt").value(options.location.alt)
+            .key("loadout").value(options.loadout)
+            .key("liveryID").value(options.liveryID)
+            .key("skill").value(options.skill)
+            .endTable();
     }
-
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.spawnUnits, {"
-        << "category = " << "\"" << "Helicopter" << "\"" << ", "
-        << "coalition = " << "\"" << coalition << "\"" << ", "
-        << "airbaseName = \"" << airbaseName << "\", "
-        << "country = \"" << country << "\", "
-        << "units = " << "{" << unitsSS.str() << "}" << "}";
-    return commandSS.str();
+    writer.endTable().endTable();
+    return writer.release();
 }
 
 /* Clone unit command */
 string Clone::getString()
 {
-    std::ostringstream unitsSS;
-    unitsSS.precision(10);
-    for (int i = 0; i < cloneOptions.size(); i++) {
-        unitsSS << "[" << i + 1 << "] = {"
-            << "ID = " << cloneOptions[i].ID << ", "
-            << "lat = " << cloneOptions[i].location.lat << ", "
-            << "lng = " << cloneOptions[i].location.lng << " }, ";
+    LuaWriter writer(64 + 64 * cloneOptions.size());
+    writer.code("Olympus.clone").beginTable();
+    for (auto const &options : cloneOptions) {
+        writer.beginTable()
+            .key("ID").value(options.ID)
+            .key("lat").value(options.location.lat)
+            .key("lng").value(options.location.lng)
+            .endTable();
     }
-
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.clone, "
-        << "{" << unitsSS.str() << "}" << ", "
-        << (deleteOriginal ? "true" : "false");
-    return commandSS.str();
-
+    writer.endTable().value(deleteOriginal);
+    return writer.release();
 }
 
 /* Delete unit command */
 string Delete::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.delete, "
-        << ID << ", "
-        << (explosion ? "true" : "false") << ", "
-        << "\"" << explosionType << "\"";
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.delete")
+        .value(ID)
+        .value(explosion)
+        .value(explosionType);
+    return writer.release();
 }
 
 /* Set task command */
 string SetTask::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.setTask, "
-        << "\"" << groupName << "\"" << ", "
-        << task;
-
-    return commandSS.str();
+    LuaWriter writer(64 + task.size());
+    writer.code("Olympus.setTask")
+        .value(groupName)
+        .code(task);
+    return writer.release();
 }
 
 /* Reset task command */
 string ResetTask::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.resetTask, "
-        << "\"" << groupName << "\"";
-
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.resetTask")
+        .value(groupName);
+    return writer.release();
 }
 
 /* Set command command */
 string SetCommand::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.setCommand, "
-        << "\"" << groupName << "\"" << ", "
-        << command;
-
-    return commandSS.str();
+    LuaWriter writer(64 + command.size());
+    writer.code("Olympus.setCommand")
+        .value(groupName)
+        .code(command);
+    return writer.release();
 }
 
 /* Set option command */
 string SetOption::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-
-    if (!isBoolean) {
-        commandSS << "Olympus.setOption, "
-            << "\"" << groupName << "\"" << ", "
-            << optionID << ", "
-            << optionValue;
-    } else {
-        commandSS << "Olympus.setOption, "
-            << "\"" << groupName << "\"" << ", "
-            << optionID << ", "
-            << (optionBool? "true": "false");
-    }
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.setOption")
+        .value(groupName)
+        .value(optionID);
+
+    if (!isBoolean)
+        writer.value(optionValue);
+    else
+        writer.value(optionBool);
+    return writer.release();
 }
 
 /* Set onOff command */
 string SetOnOff::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-
-    commandSS << "Olympus.setOnOff, "
-        << "\"" << groupName << "\"" << ", "
-        << (onOff ? "true" : "false");
- 
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.setOnOff")
+        .value(groupName)
+        .value(onOff);
+    return writer.release();
 }
 
 /* Explosion command */
 string Explosion::getString()
 {
-    std::ostringstream commandSS;
-    commandSS.precision(10);
-    commandSS << "Olympus.explosion, "
-        << intensity << ", "
-        << "\"" << explosionType << "\"" << ", "
-        << location.lat << ", "
-        << location.lng;
-    return commandSS.str();
+    LuaWriter writer;
+    writer.code("Olympus.explosion")
+        .value(intensity)
+        .value(explosionType)
+        .value(location.lat)
+        .value(location.lng);
+    return writer.release();
 }
\ No newline at end of file
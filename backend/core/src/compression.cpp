@@ -0,0 +1,133 @@
+#include "compression.h"
+#include "defines.h"
+
+#include <zlib.h>
+#include <zstd.h>
+
+/* Picks the preferred encoding accepted by the client, zstd first. Encodings with a zero quality value are refused */
+ContentEncoding negotiateContentEncoding(const string &acceptEncoding)
+{
+	bool deflate = false;
+	bool zstd = false;
+
+	size_t start = 0;
+	while (start < acceptEncoding.size())
+	{
+		size_t end = acceptEncoding.find(',', start);
+		if (end == string::npos)
+			end = acceptEncoding.size();
+
+		string token = acceptEncoding.substr(start, end - start);
+		start = end + 1;
+
+		/* Split the coding from its parameters */
+		string coding = token.substr(0, token.find(';'));
+		coding.erase(0, coding.find_first_not_of(" \t"));
+		coding.erase(coding.find_last_not_of(" \t") + 1);
+		transform(coding.begin(), coding.end(), coding.begin(), [](unsigned char c) { return tolower(c); });
+
+		size_t q = token.find("q=");
+		if (q != string::npos && atof(token.c_str() + q + 2) <= 0)
+			continue;
+
+		if (coding.compare("zstd") == 0)
+			zstd = true;
+		else if (coding.compare("deflate") == 0)
+			deflate = true;
+	}
+
+	if (zstd)
+		return ContentEncoding::zstd;
+	else if (deflate)
+		return ContentEncoding::deflate;
+	else
+		return ContentEncoding::identity;
+}
+
+string getContentEncodingName(ContentEncoding encoding)
+{
+	switch (encoding)
+	{
+	case ContentEncoding::deflate:
+		return "deflate";
+	case ContentEncoding::zstd:
+		return "zstd";
+	default:
+		return "identity";
+	}
+}
+
+/* Returns false if the data could not be compressed, in which case it must be sent as is */
+bool compressBody(const string &data, ContentEncoding encoding, string &compressed)
+{
+	switch (encoding)
+	{
+	case ContentEncoding::deflate:
+	{
+		/* HTTP deflate is the zlib format */
+		uLongf length = compressBound(static_cast<uLong>(data.size()));
+		compressed.resize(length);
+		if (compress2((Bytef *)compressed.data(), &length, (const Bytef *)data.data(), static_cast<uLong>(data.size()), COMPRESSION_DEFLATE_LEVEL) != Z_OK)
+			return false;
+		compressed.resize(length);
+		return true;
+	}
+	case ContentEncoding::zstd:
+	{
+		size_t length = ZSTD_compressBound(data.size());
+		compressed.resize(length);
+		length = ZSTD_compress(compressed.data(), length, data.data(), data.size(), COMPRESSION_ZSTD_LEVEL);
+		if (ZSTD_isError(length))
+			return false;
+		compressed.resize(length);
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+/* Compresses the body in place, unless the client only accepts the identity encoding or the body is below COMPRESSION_MIN_SIZE, where the compression
+	does not pay off. Returns false if the body is left as is */
+bool compressResponseBody(string &body, ContentEncoding encoding)
+{
+	if (encoding == ContentEncoding::identity || body.size() < COMPRESSION_MIN_SIZE)
+		return false;
+
+	string compressed;
+	if (!compressBody(body, encoding, compressed))
+		return false;
+
+	body = std::move(compressed);
+	return true;
+}
+
+bool CompressedResponseCache::get(unsigned long long version, const string &key, string &body)
+{
+	lock_guard<mutex> guard(lock);
+	if (version != this->version)
+		return false;
+
+	auto it = bodies.find(key);
+	if (it == bodies.end())
+		return false;
+
+	body = it->second;
+	return true;
+}
+
+void CompressedResponseCache::put(unsigned long long version, const string &key, const string &body)
+{
+	lock_guard<mutex> guard(lock);
+	if (version != this->version)
+	{
+		/* Older versions are never requested again, newer ones replace the cache */
+		if (version < this->version)
+			return;
+		bodies.clear();
+		this->version = version;
+	}
+
+	if (bodies.size() < COMPRESSION_CACHE_SIZE)
+		bodies[key] = body;
+}
@@ -7,7 +7,10 @@
 #include "scheduler.h"
 #include "scriptLoader.h"
 #include "luatools.h"
+#include "ingest.h"
+#include "datasnapshot.h"
 #include <chrono>
+#include <atomic>
 using namespace std::chrono;
 
 auto lastUnitsUpdate = std::chrono::system_clock::now();
@@ -19,11 +22,13 @@ UnitsManager *unitsManager = nullptr;
 WeaponsManager *weaponsManager = nullptr;
 Server *server = nullptr;
 Scheduler *scheduler = nullptr;
+Ingest *ingest = nullptr;
 
 /* Data jsons */
 json missionData = json::object();
 
 mutex mutexLock;
+atomic<unsigned long long> dataVersion = 0;     /* Monotonic version of the units and weapons data, incremented on every change */
 string sessionHash;
 string instancePath;
 
@@ -41,6 +46,10 @@ extern "C" DllExport int coreDeinit(lua_State *L)
 
     server->stop(L);
 
+    /* The ingest worker must be stopped before the units and weapons are destroyed */
+    ingest->stop();
+    delete ingest;
+
     delete unitsManager;
     delete weaponsManager;
     delete server;
@@ -66,6 +75,7 @@ extern "C" DllExport int coreInit(lua_State *L, const char *path)
     weaponsManager = new WeaponsManager(L);
     server = new Server(L);
     scheduler = new Scheduler(L);
+    ingest = new Ingest(L);
 
     registerLuaFunctions(L);
 
@@ -73,6 +83,11 @@ extern "C" DllExport int coreInit(lua_State *L, const char *path)
 
     unitsManager->loadDatabases();
 
+    /* Publish an empty snapshot, so that the REST handlers always have one to read */
+    DataSnapshot::publish();
+
+    ingest->start();
+
     initialized = true;
     return (0);
 }
@@ -82,11 +97,13 @@ extern "C" DllExport int coreFrame(lua_State *L)
     if (!initialized)
         return (0);
 
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
-
     frameCounter++;
 
+    /* Lock for thread safety. The simulation thread never waits for the lock: if it is held by the ingest worker or the server, the commands are executed on the next frame */
+    unique_lock<mutex> guard(mutexLock, try_to_lock);
+    if (!guard.owns_lock())
+        return (0);
+
     const std::chrono::duration<double> executionDuration = std::chrono::system_clock::now() - lastExecution;
     if (executionDuration.count() > (20 * FRAMERATE_TIME_INTERVAL))
     {
@@ -100,7 +117,10 @@ extern "C" DllExport int coreFrame(lua_State *L)
     }
 
     if (scheduler != nullptr)
+    {
+        scheduler->handleRequests();
         scheduler->execute(L);
+    }
 
     return (0);
 }
@@ -110,21 +130,34 @@ extern "C" DllExport int coreUnitsData(lua_State *L)
     if (!initialized)
         return (0);
 
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
+    STACK_INIT;
 
-    json unitsData = json::object();
     lua_getglobal(L, "Olympus");
     lua_getfield(L, -1, "unitsData");
-    luaTableToJSON(L, -1, unitsData);
 
     const std::chrono::duration<double> updateDuration = std::chrono::system_clock::now() - lastUnitsUpdate;
-    if (json_has_object_field(unitsData, "units"))
+    if (DATA_JSON_DECODER)
+    {
+        /* Legacy path, kept as a fallback: the whole table is converted to json and decoded on the simulation thread */
+        lock_guard<mutex> guard(mutexLock);
+
+        json unitsData = json::object();
+        luaTableToJSON(L, -1, unitsData);
+        if (json_has_object_field(unitsData, "units"))
+        {
+            unitsManager->update(unitsData["units"], updateDuration.count());
+        }
+        DataSnapshot::publish();
+    }
+    else if (lua_istable(L, -1))
     {
-        unitsManager->update(unitsData["units"], updateDuration.count());
+        /* The data is only copied here, it is applied to the units by the ingest worker thread. No lock is needed */
+        ingest->captureUnits(L, -1, updateDuration.count());
     }
     lastUnitsUpdate = std::chrono::system_clock::now();
 
+    STACK_CLEAN;
+
     return (0);
 }
 
@@ -133,21 +166,34 @@ extern "C" DllExport int coreWeaponsData(lua_State *L)
     if (!initialized)
         return (0);
 
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
+    STACK_INIT;
 
-    json weaponsData = json::object();
     lua_getglobal(L, "Olympus");
     lua_getfield(L, -1, "weaponsData");
-    luaTableToJSON(L, -1, weaponsData);
 
     const std::chrono::duration<double> updateDuration = std::chrono::system_clock::now() - lastWeaponsUpdate;
-    if (json_has_object_field(weaponsData, "weapons"))
+    if (DATA_JSON_DECODER)
     {
-        weaponsManager->update(weaponsData["weapons"], updateDuration.count());
+        /* Legacy path, kept as a fallback: the whole table is converted to json and decoded on the simulation thread */
+        lock_guard<mutex> guard(mutexLock);
+
+        json weaponsData = json::object();
+        luaTableToJSON(L, -1, weaponsData);
+        if (json_has_object_field(weaponsData, "weapons"))
+        {
+            weaponsManager->update(weaponsData["weapons"], updateDuration.count());
+        }
+        DataSnapshot::publish();
+    }
+    else if (lua_istable(L, -1))
+    {
+        /* The data is only copied here, it is applied to the weapons by the ingest worker thread. No lock is needed */
+        ingest->captureWeapons(L, -1, updateDuration.count());
     }
     lastWeaponsUpdate = std::chrono::system_clock::now();
 
+    STACK_CLEAN;
+
     return (0);
 }
 
@@ -0,0 +1,53 @@
+#include "datasnapshot.h"
+#include "unitsmanager.h"
+#include "weaponsmanager.h"
+#include "unit.h"
+#include "weapon.h"
+
+/* The snapshots are built from the units and weapons managers here, so that datasnapshot.cpp does not depend on them and can be tested on its own */
+extern UnitsManager *unitsManager;
+extern WeaponsManager *weaponsManager;
+extern atomic<unsigned long long> dataVersion;
+
+/* Set by the full refresh requests, see requestLeaderRefresh */
+static atomic<bool> leaderRefreshRequested = false;
+
+/* Takes a snapshot of the units and weapons and makes it the latest one. Must be called under the global lock, at the end of each data tick */
+void DataSnapshot::publish()
+{
+	if (leaderRefreshRequested.exchange(false))
+	{
+		for (auto const &p : unitsManager->getUnits())
+			p.second->refreshLeaderData(0);
+	}
+
+	const unsigned long long version = dataVersion.load();
+	auto latest = getLatest();
+	if (latest != nullptr && latest->version == version)
+		return;
+
+	auto snapshot = make_shared<DataSnapshot>();
+	snapshot->version = version;
+
+	auto &units = unitsManager->getUnits();
+	snapshot->units.reserve(units.size());
+	for (auto const &p : units)
+		snapshot->units.push_back(p.second->getSnapshot());
+
+	auto &weapons = weaponsManager->getWeapons();
+	snapshot->weapons.reserve(weapons.size());
+	for (auto const &p : weapons)
+		snapshot->weapons.push_back(p.second->getSnapshot());
+
+	for (unsigned char coalition = 1; coalition < 3; coalition++)
+		snapshot->visibility[coalition] = unitsManager->getVisibility(coalition);
+
+	publish(snapshot);
+}
+
+/* A full refresh used to align all the data of the group members with their leader before serializing, see Unit::getData. The requests can't modify
+	the units anymore, so the alignment is done when the next snapshot is published, and the changed data reaches the client with the next delta */
+void DataSnapshot::requestLeaderRefresh()
+{
+	leaderRefreshRequested = true;
+}
@@ -0,0 +1,196 @@
+#include "datasnapshot.h"
+#include "spatialindex.h"
+
+/* Latest published snapshot. Readers keep the snapshot they loaded alive for as long as they need it, the last one to release it frees it */
+static atomic<shared_ptr<const DataSnapshot>> latestSnapshot;
+
+/************** ObjectSnapshot **************/
+/* Same output as Unit::getData and Weapon::getData */
+void ObjectSnapshot::getData(ByteBuffer &buffer, const DataRequest &request) const
+{
+	/* Objects with nothing new are skipped entirely */
+	if (request.time != 0 && lastUpdateVersion <= request.time)
+		return;
+
+	const unsigned char endOfData = DataIndex::endOfData;
+	const size_t start = buffer.size();
+	buffer.write(ID);
+	if (!alive && request.time == 0)
+	{
+		appendDatum(buffer, DataIndex::category, request.protocol);
+		appendDatum(buffer, DataIndex::alive, request.protocol);
+	}
+	else
+	{
+		for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
+		{
+			if (request.isRequested(datumIndex) && updateVersions[datumIndex] > request.time)
+				appendDatum(buffer, datumIndex, request.protocol);
+		}
+	}
+
+	/* Only masked out data was fresh, skip the object */
+	if (request.time != 0 && buffer.size() == start + sizeof(ID))
+	{
+		buffer.resize(start);
+		return;
+	}
+	buffer.write(endOfData);
+}
+
+/* The cell history is carried over from the previous snapshot of the unit, and a new entry is added if the unit changed cell */
+void ObjectSnapshot::setPosition(const Coords &newPosition, unsigned long long version, const ObjectSnapshot *previous)
+{
+	position = newPosition;
+	const long long cell = SpatialIndex::getCellKey(position);
+
+	if (previous != nullptr)
+	{
+		copy(begin(previous->cellHistory), end(previous->cellHistory), cellHistory);
+		cellHistoryCount = previous->cellHistoryCount;
+		cellHistoryTruncated = previous->cellHistoryTruncated;
+		if (cellHistoryCount > 0 && getCell() == cell)
+			return;
+	}
+
+	if (cellHistoryCount == cellHistorySize)
+	{
+		cellHistoryTruncated = true;
+		cellHistoryCount--;
+	}
+	copy_backward(cellHistory, cellHistory + cellHistoryCount, cellHistory + cellHistoryCount + 1);
+	cellHistory[0] = { version, cell };
+	cellHistoryCount++;
+}
+
+/* Cell the unit was in when the snapshot of the given version was published */
+ObjectSnapshot::CellLookup ObjectSnapshot::getCellAt(unsigned long long version, long long &cell) const
+{
+	for (unsigned char i = 0; i < cellHistoryCount; i++)
+	{
+		if (cellHistory[i].version <= version)
+		{
+			cell = cellHistory[i].cell;
+			return cellKnown;
+		}
+	}
+	return cellHistoryTruncated ? cellUnknown : cellAbsent;
+}
+
+void ObjectSnapshot::appendDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol) const
+{
+	const shared_ptr<const string> &block = blocks[protocol - 1][datumIndex];
+	if (block != nullptr)
+		buffer.write(*block);
+}
+
+/************** DataSnapshot **************/
+/* Same output as UnitsManager::getUnitData, plus the area filter */
+void DataSnapshot::getUnitData(ByteBuffer &buffer, const DataRequest &request) const
+{
+	for (auto const &unit : units)
+	{
+		if (request.area.enabled)
+			appendAreaUnitData(buffer, *unit, request);
+		else
+			appendUnitData(buffer, *unit, request);
+	}
+}
+
+/* Weapons are not filtered by coalition: the weapons client has no removal notice, so a weapon which stopped being visible would never get its death.
+	The client hides the weapons of the other coalitions which are not among the contacts of its units */
+void DataSnapshot::getWeaponData(ByteBuffer &buffer, const DataRequest &request) const
+{
+	for (auto const &weapon : weapons)
+		weapon->getData(buffer, request);
+}
+
+/* Units which became visible get all their data, and the ones which were hidden get a removal notice */
+void DataSnapshot::appendUnitData(ByteBuffer &buffer, const ObjectSnapshot &unit, const DataRequest &request) const
+{
+	if (request.coalition < 0)
+	{
+		unit.getData(buffer, request);
+		return;
+	}
+
+	const bool visibilityChanged = request.time != 0 && unit.visibilityVersions[request.coalition] > request.time;
+	if (isVisible(unit.ID, request.coalition))
+	{
+		DataRequest fullRequest = request;
+		if (visibilityChanged)
+			fullRequest.time = 0;
+		unit.getData(buffer, fullRequest);
+	}
+	else if (visibilityChanged)
+		appendRemovalNotice(buffer, unit.ID);
+}
+
+/* Units inside the area which may have entered it since the reference version get all their data, since the client may not know them. Those are the
+	units which changed cell, or moved in a cell crossed by the area border. The units outside the area which may have left it get a removal notice.
+	The client knows the units of the area of its reference request: if that area is not this one, or is not given, all the units inside this area
+	are sent in full, and all the units which may have been inside the reference area get a removal notice */
+void DataSnapshot::appendAreaUnitData(ByteBuffer &buffer, const ObjectSnapshot &unit, const DataRequest &request) const
+{
+	const DataArea &area = request.area;
+	const DataArea &referenceArea = request.referenceArea;
+	const bool sameArea = referenceArea == area;
+	const bool positionChanged = request.time != 0 && unit.updateVersions[DataIndex::position] > request.time;
+
+	long long previousCell = 0;
+	const ObjectSnapshot::CellLookup lookup = request.time == 0 ? ObjectSnapshot::cellAbsent : unit.getCellAt(request.time, previousCell);
+
+	if (unit.alive && area.contains(unit.position))
+	{
+		const bool entered = !sameArea || lookup != ObjectSnapshot::cellKnown || previousCell != unit.getCell() ||
+			(positionChanged && !SpatialIndex::isCellInArea(area, unit.getCell()));
+		DataRequest areaRequest = request;
+		if (entered)
+			areaRequest.time = 0;
+		appendUnitData(buffer, unit, areaRequest);
+		return;
+	}
+
+	/* Only the units which were in a cell overlapping the reference area may be known to the client. Any unit may be if the reference area is not given */
+	if (request.time == 0 || lookup == ObjectSnapshot::cellAbsent)
+		return;
+	if (lookup == ObjectSnapshot::cellKnown && referenceArea.enabled && !SpatialIndex::isCellOverlappingArea(referenceArea, previousCell))
+		return;
+
+	/* The units which died are sent so that the client gets the alive state */
+	if (!unit.alive)
+	{
+		if (unit.updateVersions[DataIndex::alive] > request.time)
+			appendUnitData(buffer, unit, request);
+	}
+	else if (positionChanged || !sameArea)
+		appendRemovalNotice(buffer, unit.ID);
+}
+
+void DataSnapshot::appendRemovalNotice(ByteBuffer &buffer, unsigned int ID)
+{
+	const unsigned char removed = DataIndex::removed;
+	const unsigned char endOfData = DataIndex::endOfData;
+	buffer.write(ID);
+	buffer.write(removed);
+	buffer.write(endOfData);
+}
+
+bool DataSnapshot::isVisible(unsigned int ID, unsigned char coalition) const
+{
+	if (coalition == 0 || coalition >= 3)
+		return true;
+	return ID < visibility[coalition].size() && visibility[coalition][ID];
+}
+
+/* Makes the snapshot the latest one. The snapshots are built by the other overload, see datapublisher.cpp */
+void DataSnapshot::publish(shared_ptr<const DataSnapshot> snapshot)
+{
+	latestSnapshot.store(std::move(snapshot));
+}
+
+/* Never null once the core is initialized, an empty snapshot is published on startup */
+shared_ptr<const DataSnapshot> DataSnapshot::getLatest()
+{
+	return latestSnapshot.load();
+}
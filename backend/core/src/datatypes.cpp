@@ -1,4 +1,5 @@
 #include "datatypes.h"
+#include "geodesy.h"
 
 bool operator==(const DataTypes::TACAN& lhs, const DataTypes::TACAN& rhs)
 {
@@ -28,3 +29,92 @@ bool operator==(const DataTypes::Contact& lhs, const DataTypes::Contact& rhs)
 }
 
 
+
+DataTypes::QuantizedCoords quantizeCoords(const Coords& coords)
+{
+	DataTypes::QuantizedCoords quantized;
+	quantized.lat = static_cast<int>(round(coords.lat * 1e7));
+	quantized.lng = static_cast<int>(round(coords.lng * 1e7));
+	quantized.alt = static_cast<int>(round(coords.alt * 100));
+	return quantized;
+}
+
+short quantizeSpeed(double speed)
+{
+	return static_cast<short>(round(max(-3276.7, min(3276.7, speed)) * 10));
+}
+
+unsigned short quantizeAngle(double angle)
+{
+	const double twoPi = 6.283185307179586;
+	angle = fmod(angle, twoPi);
+	if (angle < 0)
+		angle += twoPi;
+	return static_cast<unsigned short>(static_cast<unsigned int>(round(angle / twoPi * 65536)) & 0xFFFF);
+}
+
+template <typename T>
+static void appendQuantizedDatum(string &block, unsigned char datumIndex, const T &datumValue)
+{
+	block.append((const char *)&datumIndex, sizeof(unsigned char));
+	block.append((const char *)&datumValue, sizeof(T));
+}
+
+void appendQuantizedCoords(string &block, unsigned char datumIndex, const Coords &coords)
+{
+	appendQuantizedDatum(block, datumIndex, quantizeCoords(coords));
+}
+
+void appendQuantizedSpeed(string &block, unsigned char datumIndex, double speed)
+{
+	appendQuantizedDatum(block, datumIndex, quantizeSpeed(speed));
+}
+
+void appendQuantizedAngle(string &block, unsigned char datumIndex, double angle)
+{
+	appendQuantizedDatum(block, datumIndex, quantizeAngle(angle));
+}
+
+void DataArea::setBox(double newMinLat, double newMinLng, double newMaxLat, double newMaxLng)
+{
+	enabled = true;
+	circle = false;
+	minLat = min(newMinLat, newMaxLat);
+	maxLat = max(newMinLat, newMaxLat);
+	minLng = min(newMinLng, newMaxLng);
+	maxLng = max(newMinLng, newMaxLng);
+}
+
+void DataArea::setCircle(Coords newCenter, double newRadius)
+{
+	enabled = true;
+	circle = true;
+	center = newCenter;
+	radius = newRadius;
+
+	/* Conservative box, using the smallest length of a degree of latitude and the length of a degree of longitude at the highest latitude */
+	const double latSpan = radius / 110574.0;
+	minLat = max(-90.0, center.lat - latSpan);
+	maxLat = min(90.0, center.lat + latSpan);
+	const double lngSpan = min(180.0, radius / (111320.0 * max(0.01, cos(max(abs(minLat), abs(maxLat)) / 57.29577))));
+	minLng = center.lng - lngSpan;
+	maxLng = center.lng + lngSpan;
+}
+
+bool DataArea::operator==(const DataArea &other) const
+{
+	if (enabled != other.enabled || circle != other.circle)
+		return false;
+	if (!enabled)
+		return true;
+	if (circle)
+		return center.lat == other.center.lat && center.lng == other.center.lng && radius == other.radius;
+	return minLat == other.minLat && minLng == other.minLng && maxLat == other.maxLat && maxLng == other.maxLng;
+}
+
+bool DataArea::contains(const Coords &position) const
+{
+	if (position.lat < minLat || position.lat > maxLat || position.lng < minLng || position.lng > maxLng)
+		return false;
+	return !circle || isWithinDistance(center, position, radius);
+}
@@ -0,0 +1,387 @@
+#include "ingest.h"
+
+/* Converts the name of a DCS detection method to the bitcode sent to the client */
+static unsigned char detectionMethodCode(const char *detectionMethod)
+{
+	if (strcmp(detectionMethod, "VISUAL") == 0)
+		return 1;
+	else if (strcmp(detectionMethod, "OPTIC") == 0)
+		return 2;
+	else if (strcmp(detectionMethod, "RADAR") == 0)
+		return 4;
+	else if (strcmp(detectionMethod, "IRST") == 0)
+		return 8;
+	else if (strcmp(detectionMethod, "RWR") == 0)
+		return 16;
+	else if (strcmp(detectionMethod, "DLINK") == 0)
+		return 32;
+	return 0;
+}
+
+/* Copies a Lua string into a fixed size, null terminated, char array */
+template <size_t N>
+static void copyName(char (&destination)[N], const char *source, size_t length)
+{
+	length = min(length, N - 1);
+	memcpy(destination, source, length);
+	destination[length] = '\0';
+}
+
+/************** UnitFrame **************/
+/* Reads the unit table at index (the nested table format). The frame is reused, so every field is written, but the strings and vectors keep their capacity */
+void UnitFrame::read(lua_State *L, int index, unsigned int newID)
+{
+	index = luaAbsIndex(L, index);
+
+	ID = newID;
+	hasControllerData = false;
+	ammo.clear();
+	contacts.clear();
+
+	/* Units which no longer exist only carry the isAlive field */
+	full = luaGetStringField(L, index, "category", category);
+	if (!full)
+		return;
+
+	double numberValue = 0;
+	if (!luaGetStringField(L, index, "name", name))
+		name.clear();
+
+	coalition = luaGetNumberField(L, index, "coalitionID", numberValue) ? static_cast<unsigned char>(numberValue) : 0;
+
+	position = Coords();
+	lua_getfield(L, index, "position");
+	if (lua_istable(L, -1))
+	{
+		luaGetNumberField(L, -1, "lat", position.lat);
+		luaGetNumberField(L, -1, "lng", position.lng);
+		luaGetNumberField(L, -1, "alt", position.alt);
+	}
+	lua_pop(L, 1);
+
+	heading = luaGetNumberField(L, index, "heading", numberValue) ? numberValue : 0;
+	track = luaGetNumberField(L, index, "track", numberValue) ? numberValue : heading;
+	speed = luaGetNumberField(L, index, "speed", numberValue) ? numberValue : 0;
+	horizontalVelocity = luaGetNumberField(L, index, "horizontalVelocity", numberValue) ? numberValue : 0;
+	verticalVelocity = luaGetNumberField(L, index, "verticalVelocity", numberValue) ? numberValue : 0;
+	if (!luaGetBooleanField(L, index, "isAlive", alive))
+		alive = false;
+
+	/* The controller data is only sent if the unit controller is available */
+	hasControllerData = luaGetStringField(L, index, "groupName", groupName);
+	if (!hasControllerData)
+		return;
+
+	if (!luaGetStringField(L, index, "unitName", unitName))
+		unitName.clear();
+	if (!luaGetBooleanField(L, index, "isHuman", human))
+		human = false;
+	if (!luaGetBooleanField(L, index, "hasTask", hasTask))
+		hasTask = false;
+	fuel = luaGetNumberField(L, index, "fuel", numberValue) ? numberValue : 0;
+	health = luaGetNumberField(L, index, "health", numberValue) ? numberValue : 0;
+
+	lua_getfield(L, index, "ammo");
+	if (lua_istable(L, -1))
+	{
+		lua_pushnil(L);
+		while (lua_next(L, -2))
+		{
+			if (lua_istable(L, -1))
+			{
+				DataTypes::Ammo ammoItem;
+
+				if (luaGetNumberField(L, -1, "count", numberValue))
+					ammoItem.quantity = static_cast<unsigned short>(numberValue);
+
+				lua_getfield(L, -1, "desc");
+				if (lua_istable(L, -1))
+				{
+					size_t length = 0;
+					lua_getfield(L, -1, "displayName");
+					if (lua_type(L, -1) == LUA_TSTRING)
+					{
+						const char *displayName = lua_tolstring(L, -1, &length);
+						copyName(ammoItem.name, displayName, length);
+					}
+					lua_pop(L, 1);
+
+					if (luaGetNumberField(L, -1, "guidance", numberValue))
+						ammoItem.guidance = static_cast<unsigned char>(numberValue);
+
+					if (luaGetNumberField(L, -1, "category", numberValue))
+						ammoItem.category = static_cast<unsigned char>(numberValue);
+
+					if (luaGetNumberField(L, -1, "missileCategory", numberValue))
+						ammoItem.missileCategory = static_cast<unsigned char>(numberValue);
+				}
+				lua_pop(L, 1);
+
+				ammo.push_back(ammoItem);
+			}
+			lua_pop(L, 1);
+		}
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "contacts");
+	if (lua_istable(L, -1))
+	{
+		lua_pushnil(L);
+		while (lua_next(L, -2))
+		{
+			if (lua_istable(L, -1))
+			{
+				DataTypes::Contact contactItem;
+
+				lua_getfield(L, -1, "object");
+				if (lua_istable(L, -1) && luaGetNumberField(L, -1, "id_", numberValue))
+					contactItem.ID = static_cast<unsigned int>(numberValue);
+				lua_pop(L, 1);
+
+				lua_getfield(L, -1, "detectionMethod");
+				if (lua_type(L, -1) == LUA_TSTRING)
+					contactItem.detectionMethod = detectionMethodCode(lua_tostring(L, -1));
+				lua_pop(L, 1);
+
+				contacts.push_back(contactItem);
+			}
+			lua_pop(L, 1);
+		}
+	}
+	lua_pop(L, 1);
+}
+
+/* Reads the record starting at cursor in the packed array at index, see PackedUnitField for the layout. Returns the position of the next record, or 0 if the record is malformed */
+int UnitFrame::readPacked(lua_State *L, int index, int cursor)
+{
+	index = luaAbsIndex(L, index);
+
+	double numberValue = 0;
+	const char *str = nullptr;
+	size_t strLength = 0;
+
+	if (!luaGetNumberAt(L, index, cursor, numberValue))
+		return 0;
+	ID = static_cast<unsigned int>(numberValue);
+
+	if (!luaGetNumberAt(L, index, cursor + 1, numberValue))
+		return 0;
+	const int length = static_cast<int>(numberValue);
+	if (length < 0)
+		return 0;
+	const int first = cursor + 2;
+	const int end = first + length;
+
+	hasControllerData = false;
+	ammo.clear();
+	contacts.clear();
+
+	/* A record with no fields flags that the unit no longer exists */
+	full = length >= PackedUnitField::baseLength && luaGetStringAt(L, index, first + PackedUnitField::category, str, strLength);
+	if (!full)
+		return end;
+	category.assign(str, strLength);
+
+	if (luaGetStringAt(L, index, first + PackedUnitField::name, str, strLength))
+		name.assign(str, strLength);
+	else
+		name.clear();
+
+	coalition = luaGetNumberAt(L, index, first + PackedUnitField::coalitionID, numberValue) ? static_cast<unsigned char>(numberValue) : 0;
+
+	position = Coords();
+	luaGetNumberAt(L, index, first + PackedUnitField::lat, position.lat);
+	luaGetNumberAt(L, index, first + PackedUnitField::lng, position.lng);
+	luaGetNumberAt(L, index, first + PackedUnitField::alt, position.alt);
+
+	heading = luaGetNumberAt(L, index, first + PackedUnitField::heading, numberValue) ? numberValue : 0;
+	track = luaGetNumberAt(L, index, first + PackedUnitField::track, numberValue) ? numberValue : heading;
+	speed = luaGetNumberAt(L, index, first + PackedUnitField::speed, numberValue) ? numberValue : 0;
+	horizontalVelocity = luaGetNumberAt(L, index, first + PackedUnitField::horizontalVelocity, numberValue) ? numberValue : 0;
+	verticalVelocity = luaGetNumberAt(L, index, first + PackedUnitField::verticalVelocity, numberValue) ? numberValue : 0;
+	if (!luaGetBooleanAt(L, index, first + PackedUnitField::isAlive, alive))
+		alive = false;
+
+	/* The rest of the record is only present if the unit controller is available */
+	hasControllerData = length > PackedUnitField::ammoCount;
+	if (!hasControllerData)
+		return end;
+
+	if (luaGetStringAt(L, index, first + PackedUnitField::unitName, str, strLength))
+		unitName.assign(str, strLength);
+	else
+		unitName.clear();
+
+	if (luaGetStringAt(L, index, first + PackedUnitField::groupName, str, strLength))
+		groupName.assign(str, strLength);
+	else
+		groupName.clear();
+
+	if (!luaGetBooleanAt(L, index, first + PackedUnitField::isHuman, human))
+		human = false;
+	if (!luaGetBooleanAt(L, index, first + PackedUnitField::hasTask, hasTask))
+		hasTask = false;
+	fuel = luaGetNumberAt(L, index, first + PackedUnitField::fuel, numberValue) ? numberValue : 0;
+	health = luaGetNumberAt(L, index, first + PackedUnitField::health, numberValue) ? numberValue : 0;
+
+	int field = first + PackedUnitField::ammoCount;
+
+	/* Ammo: count, followed by count items of PackedUnitField::ammoItemLength fields */
+	if (luaGetNumberAt(L, index, field, numberValue))
+	{
+		int count = static_cast<int>(numberValue);
+		field++;
+
+		for (int i = 0; i < count && field + PackedUnitField::ammoItemLength <= end; i++, field += PackedUnitField::ammoItemLength)
+		{
+			DataTypes::Ammo ammoItem;
+
+			if (luaGetNumberAt(L, index, field, numberValue))
+				ammoItem.quantity = static_cast<unsigned short>(numberValue);
+
+			if (luaGetStringAt(L, index, field + 1, str, strLength))
+				copyName(ammoItem.name, str, strLength);
+
+			if (luaGetNumberAt(L, index, field + 2, numberValue))
+				ammoItem.guidance = static_cast<unsigned char>(numberValue);
+
+			if (luaGetNumberAt(L, index, field + 3, numberValue))
+				ammoItem.category = static_cast<unsigned char>(numberValue);
+
+			if (luaGetNumberAt(L, index, field + 4, numberValue))
+				ammoItem.missileCategory = static_cast<unsigned char>(numberValue);
+
+			ammo.push_back(ammoItem);
+		}
+	}
+
+	/* Contacts: count, followed by count items of PackedUnitField::contactItemLength fields. The detection method is already a bitcode */
+	if (field < end && luaGetNumberAt(L, index, field, numberValue))
+	{
+		int count = static_cast<int>(numberValue);
+		field++;
+
+		for (int i = 0; i < count && field + PackedUnitField::contactItemLength <= end; i++, field += PackedUnitField::contactItemLength)
+		{
+			DataTypes::Contact contactItem;
+
+			if (luaGetNumberAt(L, index, field, numberValue))
+				contactItem.ID = static_cast<unsigned int>(numberValue);
+
+			if (luaGetNumberAt(L, index, field + 1, numberValue))
+				contactItem.detectionMethod = static_cast<unsigned char>(numberValue);
+
+			contacts.push_back(contactItem);
+		}
+	}
+
+	return end;
+}
+
+/* Called when the older frame of the same unit is merged into this one. The controller data is not sent every tick, it must survive the merge */
+void UnitFrame::inherit(const UnitFrame &older)
+{
+	if (!full || !older.full || hasControllerData || !older.hasControllerData)
+		return;
+
+	hasControllerData = true;
+	unitName = older.unitName;
+	groupName = older.groupName;
+	human = older.human;
+	hasTask = older.hasTask;
+	fuel = older.fuel;
+	health = older.health;
+	ammo = older.ammo;
+	contacts = older.contacts;
+}
+
+/************** WeaponFrame **************/
+/* Reads the weapon table at index. As for the units, the frame is reused, so every field is written */
+void WeaponFrame::read(lua_State *L, int index, unsigned int newID)
+{
+	index = luaAbsIndex(L, index);
+
+	ID = newID;
+
+	/* Weapons which no longer exist only carry the isAlive field */
+	full = luaGetStringField(L, index, "category", category);
+	if (!full)
+		return;
+
+	double numberValue = 0;
+	if (!luaGetStringField(L, index, "name", name))
+		name.clear();
+
+	coalition = luaGetNumberField(L, index, "coalitionID", numberValue) ? static_cast<unsigned char>(numberValue) : 0;
+
+	position = Coords();
+	lua_getfield(L, index, "position");
+	if (lua_istable(L, -1))
+	{
+		luaGetNumberField(L, -1, "lat", position.lat);
+		luaGetNumberField(L, -1, "lng", position.lng);
+		luaGetNumberField(L, -1, "alt", position.alt);
+	}
+	lua_pop(L, 1);
+
+	heading = luaGetNumberField(L, index, "heading", numberValue) ? numberValue : 0;
+	speed = luaGetNumberField(L, index, "speed", numberValue) ? numberValue : 0;
+	if (!luaGetBooleanField(L, index, "isAlive", alive))
+		alive = false;
+}
+
+/************** FrameBuffer **************/
+/* Reads the units data table at index, in the packed and in the nested table formats, into the buffer */
+void readUnitsData(lua_State *L, int index, FrameBuffer<UnitFrame> &buffer)
+{
+	index = luaAbsIndex(L, index);
+
+	lua_getfield(L, index, "packed");
+	if (lua_istable(L, -1))
+	{
+		const int size = static_cast<int>(lua_objlen(L, -1));
+		int cursor = 1;
+		while (cursor > 0 && cursor + 1 <= size)
+		{
+			cursor = buffer.next().readPacked(L, -1, cursor);
+
+			/* Drop the malformed record and stop parsing, the positions of the next records are unknown */
+			if (cursor == 0)
+				buffer.size--;
+		}
+	}
+	lua_pop(L, 1);
+
+	lua_getfield(L, index, "units");
+	if (lua_istable(L, -1))
+	{
+		lua_pushnil(L);
+		while (lua_next(L, -2))
+		{
+			if (lua_type(L, -2) == LUA_TNUMBER && lua_istable(L, -1))
+				buffer.next().read(L, -1, static_cast<unsigned int>(lua_tonumber(L, -2)));
+			lua_pop(L, 1);
+		}
+	}
+	lua_pop(L, 1);
+}
+
+/* Reads the weapons data table at index into the buffer */
+void readWeaponsData(lua_State *L, int index, FrameBuffer<WeaponFrame> &buffer)
+{
+	index = luaAbsIndex(L, index);
+
+	lua_getfield(L, index, "weapons");
+	if (lua_istable(L, -1))
+	{
+		lua_pushnil(L);
+		while (lua_next(L, -2))
+		{
+			if (lua_type(L, -2) == LUA_TNUMBER && lua_istable(L, -1))
+				buffer.next().read(L, -1, static_cast<unsigned int>(lua_tonumber(L, -2)));
+			lua_pop(L, 1);
+		}
+	}
+	lua_pop(L, 1);
+}
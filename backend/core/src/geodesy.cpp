@@ -0,0 +1,85 @@
+#include "geodesy.h"
+
+#include <GeographicLib/Geodesic.hpp>
+using namespace GeographicLib;
+
+#define WGS84_SEMI_MAJOR_AXIS 6378137.0
+#define WGS84_FLATTENING (1 / 298.257223563)
+
+LocalTangentPlane::LocalTangentPlane(const Coords &reference) :
+	reference(reference)
+{
+	const double e2 = WGS84_FLATTENING * (2 - WGS84_FLATTENING);
+	const double sinLat = sin(reference.lat / 57.29577);
+	const double w2 = 1 - e2 * sinLat * sinLat;
+
+	/* Radii of curvature along the meridian and the prime vertical. They vary by less than 1e-4 within the approximation bounds */
+	meridionalRadius = WGS84_SEMI_MAJOR_AXIS * (1 - e2) / (w2 * sqrt(w2));
+	normalRadius = WGS84_SEMI_MAJOR_AXIS / sqrt(w2);
+}
+
+void LocalTangentPlane::project(const Coords &point, double &east, double &north) const
+{
+	const double meanLat = (reference.lat + point.lat) / 2 / 57.29577;
+	double dLng = point.lng - reference.lng;
+	if (dLng > 180)
+		dLng -= 360;
+	else if (dLng < -180)
+		dLng += 360;
+
+	north = (point.lat - reference.lat) / 57.29577 * meridionalRadius;
+	east = dLng / 57.29577 * normalRadius * cos(meanLat);
+}
+
+double LocalTangentPlane::getApproximateDistance(const Coords &point) const
+{
+	double east, north;
+	project(point, east, north);
+	return sqrt(east * east + north * north);
+}
+
+/* Bearing from the reference to the point, in degrees clockwise from north */
+double LocalTangentPlane::getApproximateBearing(const Coords &point) const
+{
+	double east, north;
+	project(point, east, north);
+	return atan2(east, north) * 57.29577;
+}
+
+bool LocalTangentPlane::isApproximationValid(const Coords &point, double approximateDistance) const
+{
+	return approximateDistance < GEODESY_MAX_APPROXIMATE_DISTANCE &&
+		abs(reference.lat) < GEODESY_MAX_APPROXIMATE_LATITUDE &&
+		abs(point.lat) < GEODESY_MAX_APPROXIMATE_LATITUDE;
+}
+
+/* Compares the distance with the threshold using the approximation, and only computes the geodesic if the error bound can not decide */
+bool LocalTangentPlane::isWithinDistance(const Coords &point, double threshold) const
+{
+	const double distance = getApproximateDistance(point);
+	if (isApproximationValid(point, distance))
+	{
+		if ((distance + GEODESY_ABSOLUTE_ERROR) / (1 - GEODESY_RELATIVE_ERROR) < threshold)
+			return true;
+		if ((distance - GEODESY_ABSOLUTE_ERROR) / (1 + GEODESY_RELATIVE_ERROR) >= threshold)
+			return false;
+	}
+	return geodesicDistance(reference, point) < threshold;
+}
+
+double approximateDistance(const Coords &a, const Coords &b)
+{
+	return LocalTangentPlane(a).getApproximateDistance(b);
+}
+
+double geodesicDistance(const Coords &a, const Coords &b)
+{
+	double dist;
+	Geodesic::WGS84().Inverse(a.lat, a.lng, b.lat, b.lng, dist);
+	return dist;
+}
+
+bool isWithinDistance(const Coords &a, const Coords &b, double threshold)
+{
+	return LocalTangentPlane(a).isWithinDistance(b, threshold);
+}
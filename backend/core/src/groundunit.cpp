@@ -2,6 +2,7 @@
 #include "utils.h"
 #include "logger.h"
 #include "commands.h"
+#include "luawriter.h"
 #include "scheduler.h"
 #include "defines.h"
 #include "unitsmanager.h"
@@ -178,9 +179,12 @@ void GroundUnit::AIloop()
 		string enrouteTask = "";
 		bool looping = false;
 
-		std::ostringstream taskSS;
-		taskSS << "{ id = 'FollowRoads', value = " << (getFollowRoads() ? "true" : "false") << " }";
-		enrouteTask = taskSS.str();
+		LuaWriter taskWriter;
+		taskWriter.beginTable()
+			.key("id").value("FollowRoads")
+			.key("value").value(getFollowRoads())
+			.endTable();
+		enrouteTask = taskWriter.release();
 
 		if (activeDestination == NULL || !getHasTask())
 		{
@@ -211,10 +215,12 @@ void GroundUnit::AIloop()
 			if (!getHasTask())
 			{
 				/* Send the command */
-				std::ostringstream taskSS;
-				taskSS.precision(10);
-				taskSS << "{id = 'AttackUnit', unitID = " << target->getID() << " }";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable()
+					.key("id").value("AttackUnit")
+					.key("unitID").value(target->getID())
+					.endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -233,10 +239,14 @@ void GroundUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			taskSS.precision(10);
-			taskSS << "{id = 'FireAtPoint', lat = " << targetPosition.lat << ", lng = " << targetPosition.lng << ", radius = 100}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("FireAtPoint")
+				.key("lat").value(targetPosition.lat)
+				.key("lng").value(targetPosition.lng)
+				.key("radius").value(100)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -280,10 +290,14 @@ void GroundUnit::AIloop()
 			if (indirectFire)
 			{
 				log(unitName + "(" + name + ")" + " simulating fire fight with indirect fire");
-				std::ostringstream taskSS;
-				taskSS.precision(10);
-				taskSS << "{id = 'FireAtPoint', lat = " << scatteredTargetPosition.lat << ", lng = " << scatteredTargetPosition.lng << ", radius = 100}";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable()
+					.key("id").value("FireAtPoint")
+					.key("lat").value(scatteredTargetPosition.lat)
+					.key("lng").value(scatteredTargetPosition.lng)
+					.key("radius").value(100)
+					.endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -344,10 +358,15 @@ void GroundUnit::AIloop()
 				double randomBearing = ((double)(rand()) / (double)(RAND_MAX)) * 360;
 				Geodesic::WGS84().Direct(position.lat, position.lng, randomBearing, r, lat, lng);
 
-				std::ostringstream taskSS;
-				taskSS.precision(10);
-				taskSS << "{id = 'FireAtPoint', lat = " << lat << ", lng = " << lng << ", alt = " << position.alt + barrelElevation << ", radius = 0.001}";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable()
+					.key("id").value("FireAtPoint")
+					.key("lat").value(lat)
+					.key("lng").value(lng)
+					.key("alt").value(position.alt + barrelElevation)
+					.key("radius").value(0.001)
+					.endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -450,10 +469,12 @@ void GroundUnit::AIloop()
 					if (distance < targetingRange && shotsScatter == ShotsScatter::LOW)
 					{
 						/* Send the command */
-						std::ostringstream taskSS;
-						taskSS.precision(10);
-						taskSS << "{id = 'AttackUnit', unitID = " << target->getID() << " }";
-						Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+						LuaWriter taskWriter;
+						taskWriter.beginTable()
+							.key("id").value("AttackUnit")
+							.key("unitID").value(target->getID())
+							.endTable();
+						Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																			   { this->setHasTaskAssigned(true); }));
 						scheduler->appendCommand(command);
 						setHasTask(true);
@@ -475,10 +496,16 @@ void GroundUnit::AIloop()
 						if (distance < engagementRange)
 						{
 							/* If the unit is closer than the engagement range, use the fire at point method */
-							std::ostringstream taskSS;
-							taskSS.precision(10);
-							taskSS << "{id = 'FireAtPoint', lat = " << aimLat << ", lng = " << aimLng << ", alt = " << aimAlt << ", radius = 0.001, expendQty = " << shotsToFire << " }";
-							Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+							LuaWriter taskWriter;
+							taskWriter.beginTable()
+								.key("id").value("FireAtPoint")
+								.key("lat").value(aimLat)
+								.key("lng").value(aimLng)
+								.key("alt").value(aimAlt)
+								.key("radius").value(0.001)
+								.key("expendQty").value(shotsToFire)
+								.endTable();
+							Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																				   { this->setHasTaskAssigned(true); }));
 							scheduler->appendCommand(command);
 							setHasTask(true);
@@ -495,10 +522,16 @@ void GroundUnit::AIloop()
 						else
 						{
 							/* Else just wake the unit up with an impossible command */
-							std::ostringstream taskSS;
-							taskSS.precision(10);
-							taskSS << "{id = 'FireAtPoint', lat = " << 0 << ", lng = " << 0 << ", alt = " << 0 << ", radius = 0.001, expendQty = " << 0 << " }";
-							Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+							LuaWriter taskWriter;
+							taskWriter.beginTable()
+								.key("id").value("FireAtPoint")
+								.key("lat").value(0)
+								.key("lng").value(0)
+								.key("alt").value(0)
+								.key("radius").value(0.001)
+								.key("expendQty").value(0)
+								.endTable();
+							Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																				   { this->setHasTaskAssigned(true); }));
 							scheduler->appendCommand(command);
 							setHasTask(true);
@@ -588,10 +621,15 @@ void GroundUnit::aimAtPoint(Coords aimTarget)
 
 		log(unitName + "(" + name + ")" + " shooting with aim at point method. Barrel elevation: " + to_string(barrelElevation * 57.29577) + "�, bearing: " + to_string(bearing1) + "�");
 
-		std::ostringstream taskSS;
-		taskSS.precision(10);
-		taskSS << "{id = 'FireAtPoint', lat = " << lat << ", lng = " << lng << ", alt = " << position.alt + barrelElevation + barrelHeight << ", radius = 0.001}";
-		Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+		LuaWriter taskWriter;
+		taskWriter.beginTable()
+			.key("id").value("FireAtPoint")
+			.key("lat").value(lat)
+			.key("lng").value(lng)
+			.key("alt").value(position.alt + barrelElevation + barrelHeight)
+			.key("radius").value(0.001)
+			.endTable();
+		Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 															   { this->setHasTaskAssigned(true); }));
 		scheduler->appendCommand(command);
 		setHasTask(true);
@@ -0,0 +1,182 @@
+#include "ingest.h"
+#include "logger.h"
+#include "unitsmanager.h"
+#include "weaponsmanager.h"
+#include "server.h"
+#include "datasnapshot.h"
+
+#include <chrono>
+using namespace std::chrono;
+
+extern UnitsManager *unitsManager;
+extern WeaponsManager *weaponsManager;
+extern Server *server;
+extern mutex mutexLock;
+
+/************** Ingest **************/
+Ingest::Ingest(lua_State *L)
+{
+	LogInfo(L, "Ingest pipeline constructor called successfully");
+}
+
+Ingest::~Ingest()
+{
+	stop();
+
+	for (auto buffer : pendingUnits)
+		delete buffer;
+	for (auto buffer : freeUnits)
+		delete buffer;
+	for (auto buffer : pendingWeapons)
+		delete buffer;
+	for (auto buffer : freeWeapons)
+		delete buffer;
+}
+
+void Ingest::start()
+{
+	lock_guard<mutex> guard(queueLock);
+	if (running)
+		return;
+
+	running = true;
+	worker = thread(&Ingest::run, this);
+}
+
+/* Stops the worker thread. Must be called before the units and weapons managers are destroyed. Frames not yet applied are discarded */
+void Ingest::stop()
+{
+	{
+		lock_guard<mutex> guard(queueLock);
+		running = false;
+	}
+	queueCondition.notify_all();
+
+	if (worker.joinable())
+		worker.join();
+}
+
+/* Called on the simulation thread. The units data table at index is only copied into a frame buffer, the work is done by the worker thread */
+void Ingest::captureUnits(lua_State *L, int index, double dt)
+{
+	FrameBuffer<UnitFrame> *buffer = acquireBuffer(freeUnits);
+	buffer->dt = dt;
+
+	readUnitsData(L, index, *buffer);
+
+	submitBuffer(pendingUnits, buffer);
+}
+
+/* Called on the simulation thread. The weapons data table at index is only copied into a frame buffer, the work is done by the worker thread */
+void Ingest::captureWeapons(lua_State *L, int index, double dt)
+{
+	FrameBuffer<WeaponFrame> *buffer = acquireBuffer(freeWeapons);
+	buffer->dt = dt;
+
+	readWeaponsData(L, index, *buffer);
+
+	submitBuffer(pendingWeapons, buffer);
+}
+
+/* Moves the buffers submitted since the last call to the worker, waiting for INGEST_LOCK_RETRY_INTERVAL at most if there are none when wait is true.
+	Returns false if the worker must stop */
+bool Ingest::takePendingBuffers(deque<FrameBuffer<UnitFrame> *> &units, deque<FrameBuffer<WeaponFrame> *> &weapons, bool wait)
+{
+	deque<FrameBuffer<UnitFrame> *> releasedUnits;
+	deque<FrameBuffer<WeaponFrame> *> releasedWeapons;
+	{
+		unique_lock<mutex> lock(queueLock);
+		if (wait)
+			queueCondition.wait_for(lock, microseconds(INGEST_LOCK_RETRY_INTERVAL), [this] { return !running || !pendingUnits.empty() || !pendingWeapons.empty(); });
+		if (!running)
+			return false;
+
+		units.insert(units.end(), pendingUnits.begin(), pendingUnits.end());
+		pendingUnits.clear();
+		weapons.insert(weapons.end(), pendingWeapons.begin(), pendingWeapons.end());
+		pendingWeapons.clear();
+	}
+
+	/* The merge runs outside of queueLock, the simulation thread can keep capturing meanwhile */
+	coalesceBuffers(units, releasedUnits);
+	coalesceBuffers(weapons, releasedWeapons);
+
+	if (!releasedUnits.empty() || !releasedWeapons.empty())
+	{
+		lock_guard<mutex> guard(queueLock);
+		releaseBuffers(releasedUnits, freeUnits);
+		releaseBuffers(releasedWeapons, freeWeapons);
+	}
+	return true;
+}
+
+/* Worker thread loop. All the buffers submitted since the last iteration are applied in order under the global lock, and then returned to the free lists.
+	If the worker falls behind, for instance while the global lock is held by the simulation thread or a REST handler, the oldest buffers are merged here, so
+	that the memory used by the queue is bounded and the simulation thread never does more than copying the data */
+void Ingest::run()
+{
+	deque<FrameBuffer<UnitFrame> *> units;
+	deque<FrameBuffer<WeaponFrame> *> weapons;
+
+	while (true)
+	{
+		{
+			unique_lock<mutex> lock(queueLock);
+			queueCondition.wait(lock, [this] { return !running || !pendingUnits.empty() || !pendingWeapons.empty(); });
+		}
+
+		bool stopping = !takePendingBuffers(units, weapons, false);
+		unique_lock<mutex> globalLock(mutexLock, defer_lock);
+		while (!stopping && !globalLock.try_lock())
+			stopping = !takePendingBuffers(units, weapons, true);
+
+		if (!stopping)
+		{
+			/* A failed update must not leave the snapshot stale, the units and weapons are published as they are */
+			try
+			{
+				for (auto buffer : units)
+					unitsManager->update(*buffer);
+			}
+			catch (const exception &e)
+			{
+				log("Exception while applying the units data: " + string(e.what()));
+			}
+
+			try
+			{
+				for (auto buffer : weapons)
+					weaponsManager->update(*buffer);
+			}
+			catch (const exception &e)
+			{
+				log("Exception while applying the weapons data: " + string(e.what()));
+			}
+
+			/* The REST handlers and the data stream read the data from the snapshot, not from the units */
+			try
+			{
+				DataSnapshot::publish();
+			}
+			catch (const exception &e)
+			{
+				log("Exception while publishing the data snapshot: " + string(e.what()));
+			}
+			globalLock.unlock();
+
+			/* Push the changes of this tick to the data stream subscribers */
+			server->publishData();
+		}
+
+		{
+			lock_guard<mutex> guard(queueLock);
+			freeUnits.insert(freeUnits.end(), units.begin(), units.end());
+			freeWeapons.insert(freeWeapons.end(), weapons.begin(), weapons.end());
+		}
+		units.clear();
+		weapons.clear();
+
+		if (stopping)
+			break;
+	}
+}
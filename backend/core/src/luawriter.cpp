@@ -0,0 +1,95 @@
+#include "luawriter.h"
+
+#include <cmath>
+
+LuaWriter &LuaWriter::code(const string &source)
+{
+	separate();
+	buffer.append(source);
+	return *this;
+}
+
+LuaWriter &LuaWriter::value(double number)
+{
+	separate();
+
+	/* Lua has no literals for infinity and NaN */
+	if (isnan(number))
+		buffer.append("(0/0)");
+	else if (isinf(number))
+		buffer.append(number > 0 ? "math.huge" : "-math.huge");
+	else
+	{
+		char digits[32];
+		const auto result = to_chars(digits, digits + sizeof(digits), number);
+		buffer.append(digits, result.ptr);
+	}
+	return *this;
+}
+
+LuaWriter &LuaWriter::value(bool boolean)
+{
+	separate();
+	buffer.append(boolean ? "true" : "false");
+	return *this;
+}
+
+/* Names of units, groups and liveries come from the mission and the clients, they must not be able to break out of the string */
+LuaWriter &LuaWriter::quoted(string_view text)
+{
+	separate();
+	buffer.push_back('"');
+	for (const unsigned char character : text)
+	{
+		switch (character)
+		{
+		case '"': buffer.append("\\\""); break;
+		case '\\': buffer.append("\\\\"); break;
+		case '\n': buffer.append("\\n"); break;
+		case '\r': buffer.append("\\r"); break;
+		case '\t': buffer.append("\\t"); break;
+		default:
+			if (character < 0x20 || character == 0x7F)
+			{
+				/* Lua 5.1 only has decimal escapes, always written with three digits so that a following digit is not read as part of them */
+				const char escape[5] = { '\\', static_cast<char>('0' + character / 100), static_cast<char>('0' + character / 10 % 10), static_cast<char>('0' + character % 10), 0 };
+				buffer.append(escape, 4);
+			}
+			else
+				buffer.push_back(static_cast<char>(character));
+		}
+	}
+	buffer.push_back('"');
+	return *this;
+}
+
+LuaWriter &LuaWriter::key(const char *name)
+{
+	separate();
+	buffer.append(name);
+	buffer.append(" = ");
+	separatorNeeded = false;
+	return *this;
+}
+
+LuaWriter &LuaWriter::beginTable()
+{
+	separate();
+	buffer.push_back('{');
+	separatorNeeded = false;
+	return *this;
+}
+
+LuaWriter &LuaWriter::endTable()
+{
+	buffer.push_back('}');
+	separatorNeeded = true;
+	return *this;
+}
+
+void LuaWriter::separate()
+{
+	if (separatorNeeded)
+		buffer.append(", ");
+	separatorNeeded = true;
+}
@@ -2,6 +2,7 @@
 #include "utils.h"
 #include "logger.h"
 #include "commands.h"
+#include "luawriter.h"
 #include "scheduler.h"
 #include "defines.h"
 #include "unitsManager.h"
@@ -203,10 +204,12 @@ void NavyUnit::AIloop()
 			if (!getHasTask())
 			{
 				/* Send the command */
-				std::ostringstream taskSS;
-				taskSS.precision(10);
-				taskSS << "{id = 'AttackUnit', unitID = " << target->getID() << " }";
-				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+				LuaWriter taskWriter;
+				taskWriter.beginTable()
+					.key("id").value("AttackUnit")
+					.key("unitID").value(target->getID())
+					.endTable();
+				Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																	   { this->setHasTaskAssigned(true); }));
 				scheduler->appendCommand(command);
 				setHasTask(true);
@@ -225,11 +228,14 @@ void NavyUnit::AIloop()
 
 		if (!getHasTask())
 		{
-			std::ostringstream taskSS;
-			taskSS.precision(10);
-
-			taskSS << "{id = 'FireAtPoint', lat = " << targetPosition.lat << ", lng = " << targetPosition.lng << ", radius = 1000}";
-			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskSS.str(), [this]()
+			LuaWriter taskWriter;
+			taskWriter.beginTable()
+				.key("id").value("FireAtPoint")
+				.key("lat").value(targetPosition.lat)
+				.key("lng").value(targetPosition.lng)
+				.key("radius").value(1000)
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetTask(groupName, taskWriter.release(), [this]()
 																   { this->setHasTaskAssigned(true); }));
 			scheduler->appendCommand(command);
 			setHasTask(true);
@@ -4,6 +4,10 @@
 #include "unitsManager.h"
 #include "utils.h"
 #include "unit.h"
+#include "defines.h"
+
+#include <chrono>
+using namespace std::chrono;
 
 extern UnitsManager *unitsManager;
 
@@ -16,65 +20,249 @@ Scheduler::~Scheduler()
 {
 }
 
-/* Appends a */
-void Scheduler::appendCommand(Command *newCommand)
+/* Appends a command to the queue of its priority. A command identical to one already queued with the same priority is discarded and deleted, and false is returned
+	with the hash of the queued one in queuedHash.
+	A queued command with the same supersede key is dropped, so that only the last path, task or option of a group is sent to DCS. The new command is still
+	queued last, so that it runs after the other commands queued before it, and it runs the callback of the dropped one */
+bool Scheduler::appendCommand(Command *newCommand, string *queuedHash)
 {
-	for (auto command : commands)
+	const unsigned int priority = min(newCommand->getPriority(), static_cast<unsigned int>(CommandPriority::IMMEDIATE));
+	auto inserted = queuedCommandsStrings[priority].emplace(newCommand->getString(), newCommand->getHash());
+	if (!inserted.second)
 	{
-		if (command->getString().compare(newCommand->getString()) == 0 && command->getPriority() == newCommand->getPriority())
-			return;
+		if (queuedHash != nullptr)
+			*queuedHash = inserted.first->second;
+		delete newCommand;
+		return false;
 	}
-	commands.push_back(newCommand);
-}
 
-int Scheduler::getLoad()
-{
-	int currentLoad = 0;
-	for (auto command : commands)
+	const string supersedeKey = newCommand->getSupersedeKey();
+	auto superseded = supersedeKey.empty() ? supersedableCommands[priority].end() : supersedableCommands[priority].find(supersedeKey);
+	if (superseded != supersedableCommands[priority].end())
 	{
-		currentLoad += command->getLoad();
+		QueuedCommand *queued = superseded->second;
+		Command *oldCommand = queued->command;
+
+		queuedCommandsStrings[priority].erase(*queued->commandString);
+		queuedCommandsHashes.erase(oldCommand->getHash());
+		queuedLoad -= oldCommand->getLoad();
+
+		newCommand->inheritCallback(oldCommand);
+		setCommandFinished(oldCommand->getHash(), CommandStatus::SUPERSEDED);
+		delete oldCommand;
+		supersededCommands++;
+
+		/* The empty slot is skipped by execute */
+		queued->command = nullptr;
 	}
-	return currentLoad;
+
+	commands[priority].push_back({ newCommand, &inserted.first->first, supersedeKey });
+	if (!supersedeKey.empty())
+		supersedableCommands[priority][supersedeKey] = &commands[priority].back();
+
+	queuedCommandsHashes.insert(newCommand->getHash());
+	queuedLoad += newCommand->getLoad();
+	return true;
 }
 
+/* Lua statement of a single command in a batch chunk, see getBatchChunk. Each command runs in its own protected call, which only contains its runtime
+	errors: a syntax error in any entry fails the compilation of the whole chunk */
+static string getCommandEntry(const string &commandString)
+{
+	if (SCHEDULER_DISPATCH_BATCH)
+		return "{" + commandString + "},\n";
+	else
+		return "Olympus.protectedCall(" + commandString + ")\n";
+}
+
+static string getBatchChunk(const string &entries)
+{
+	if (SCHEDULER_DISPATCH_BATCH)
+		return "return Olympus.dispatch({\n" + entries + "})";
+	else
+		return entries;
+}
+
+/* Runs a chunk built by getBatchChunk. Returns false if the chunk failed as a whole, in which case none of its commands ran. Otherwise failedIndex is the
+	index, starting from 1, of the command at which Olympus.dispatch stopped, or 0 if all the commands ran */
+static bool runBatchChunk(lua_State *L, const string &chunk, size_t &failedIndex)
+{
+	string result;
+	if (dostring_in(L, "server", chunk, result))
+		return false;
+	failedIndex = strtoul(result.c_str(), nullptr, 10);
+	return true;
+}
+
+/* Adds the cost per command measured on a batch of commandsCount commands of this type */
+void CommandCost::addSample(double cost, unsigned int commandsCount)
+{
+	average = count == 0 ? cost : 0.9 * average + 0.1 * cost;
+	count += commandsCount;
+
+	samples.push_back(cost);
+	if (samples.size() > SCHEDULER_COST_SAMPLES)
+		samples.pop_front();
+
+	vector<double> sorted(samples.begin(), samples.end());
+	auto percentile = sorted.begin() + (sorted.size() * 95) / 100;
+	if (percentile == sorted.end())
+		percentile--;
+	nth_element(sorted.begin(), percentile, sorted.end());
+	p95 = *percentile;
+}
+
+/* Expected execution time of the command, in microseconds. The command types which were never measured are estimated from their load */
+double Scheduler::estimateCost(Command *command)
+{
+	auto it = costs.find(command->getName());
+	if (it != costs.end())
+		return it->second.average;
+	return command->getLoad() * loadCost;
+}
+
+/* Runs the queued commands, highest priority first. The batch holds as many commands as fit in the SCHEDULER_EXECUTION_BUDGET, and at least one. The
+	consecutive commands of the same type run as a single Lua chunk, whose execution time is measured to update the cost of that type. The time spent over
+	the budget delays the next batches. This is needed to avoid server lag. Olympus.dispatch stops at the first command raising an error, the commands after
+	it are sent again in a new chunk, so that no command runs twice. A chunk which fails as a whole, because one of its commands does not compile, is run
+	again one command at a time, so that only the faulty commands are lost */
 void Scheduler::execute(lua_State *L)
 {
-	/* Decrease the active computation load. New commands can be sent only if the load has reached 0.
-		This is needed to avoid server lag. */
-	if (load > 0)
+	const double budget = SCHEDULER_EXECUTION_BUDGET - executionDebt;
+	if (budget <= 0)
 	{
-		load--;
+		executionDebt -= SCHEDULER_EXECUTION_BUDGET;
 		return;
 	}
 
-	int priority = CommandPriority::IMMEDIATE;
-	while (priority >= CommandPriority::LOW)
+	vector<CommandBatch> batches;
+	double estimatedCost = 0;
+	for (int priority = CommandPriority::IMMEDIATE; priority >= CommandPriority::LOW; priority--)
 	{
-		for (auto command : commands)
+		while (!commands[priority].empty())
+		{
+			QueuedCommand queued = commands[priority].front();
+			Command *command = queued.command;
+			if (command == nullptr)
+			{
+				commands[priority].pop_front();
+				continue;
+			}
+
+			const double cost = estimateCost(command);
+			if (!batches.empty() && estimatedCost + cost > budget)
+				break;
+
+			const string name = command->getName();
+			if (batches.empty() || batches.back().name != name)
+				batches.push_back({ name, "", {} });
+
+			if (!queued.supersedeKey.empty())
+				supersedableCommands[priority].erase(queued.supersedeKey);
+			commands[priority].pop_front();
+			batches.back().chunk += getCommandEntry(*queued.commandString);
+			batches.back().commands.push_back(command);
+			queuedCommandsStrings[priority].erase(*queued.commandString);
+			queuedLoad -= command->getLoad();
+			queuedCommandsHashes.erase(command->getHash());
+			estimatedCost += cost;
+		}
+
+		/* The lower priorities must wait for the commands left in this queue */
+		if (!commands[priority].empty())
+			break;
+	}
+
+	double elapsed = 0;
+	for (auto &batch : batches)
+	{
+		batch.chunk = getBatchChunk(batch.chunk);
+
+		unsigned int batchLoad = 0;
+		for (auto command : batch.commands)
+			batchLoad += command->getLoad();
+
+		const auto start = steady_clock::now();
+		vector<bool> succeeded(batch.commands.size(), true);
+		size_t next = 0;	/* First command which did not run yet */
+		string chunk = std::move(batch.chunk);
+		while (next < batch.commands.size())
 		{
-			if (command->getPriority() == priority)
+			size_t failedIndex = 0;
+			if (!runBatchChunk(L, chunk, failedIndex))
+			{
+				/* None of the remaining commands ran, a single command already failed on its own */
+				log("Error executing commands " + chunk);
+				const bool single = batch.commands.size() - next == 1;
+				for (size_t i = next; i < batch.commands.size(); i++)
+				{
+					succeeded[i] = !single && runBatchChunk(L, getBatchChunk(getCommandEntry(batch.commands[i]->getString())), failedIndex) && failedIndex == 0;
+					if (!succeeded[i])
+						log("Error executing command " + batch.commands[i]->getString());
+				}
+				break;
+			}
+			if (failedIndex == 0 || failedIndex > batch.commands.size() - next)
 			{
-				string commandString = "Olympus.protectedCall(" + command->getString() + ")";
-				if (dostring_in(L, "server", (commandString)))
-					log("Error executing command " + commandString);
-				else
-					log("Command '" + commandString + "' executed correctly, current load " + to_string(getLoad()));
-
-				/* Adjust the load depending on the fps */
-				double fpsMultiplier = 20;
-				if (getFrameRate() + 3 > 0)
-					fpsMultiplier = static_cast<unsigned int>(max(1, 60 / (getFrameRate() + 3))); /* Multiplier between 1 and 20 */
-
-				load = static_cast<unsigned int>(command->getLoad() * fpsMultiplier);
-				commands.remove(command);
-				executedCommandsHashes.push_back(command->getHash());
+				log(to_string(batch.commands.size() - next) + " " + batch.name + " commands executed correctly, current load " + to_string(getLoad()));
+				break;
+			}
+
+			/* The commands before the failed one ran and must not run again, the batch carries on after it */
+			const size_t failed = next + failedIndex - 1;
+			succeeded[failed] = false;
+			log("Error executing command " + batch.commands[failed]->getString());
+			next = failed + 1;
+
+			string entries;
+			for (size_t i = next; i < batch.commands.size(); i++)
+				entries += getCommandEntry(batch.commands[i]->getString());
+			chunk = getBatchChunk(entries);
+		}
+		const double batchElapsed = duration<double, micro>(steady_clock::now() - start).count();
+		elapsed += batchElapsed;
+
+		const unsigned int commandsCount = static_cast<unsigned int>(batch.commands.size());
+		costs[batch.name].addSample(batchElapsed / commandsCount, commandsCount);
+		if (batchLoad > 0)
+			loadCost = 0.9 * loadCost + 0.1 * batchElapsed / batchLoad;
+
+		for (size_t i = 0; i < batch.commands.size(); i++)
+		{
+			Command *command = batch.commands[i];
+			if (succeeded[i])
+			{
+				setCommandExecuted(command->getHash());
 				command->executeCallback(); /* Execute the command callback (this is a lambda function that can be used to execute a function when the command is run) */
-				delete command;
-				return;
 			}
+			else
+				setCommandFailed(command->getHash());
+			delete command;
 		}
-		priority--;
-	};
+	}
+
+	executionDebt = max(0.0, elapsed - budget);
+}
+
+/* Measured cost of each command type, see CommandCost */
+json Scheduler::getCostStatistics()
+{
+	json json = json::object();
+
+	json["load"] = getLoad();
+	json["loadCost"] = loadCost;
+	json["executionBudget"] = SCHEDULER_EXECUTION_BUDGET;
+	json["executionDebt"] = executionDebt;
+	json["supersededCommands"] = supersededCommands;
+	json["commands"] = json::object();
+	for (auto const &p : costs)
+	{
+		json["commands"][p.first]["average"] = p.second.average;
+		json["commands"][p.first]["p95"] = p.second.p95;
+		json["commands"][p.first]["count"] = p.second.count;
+	}
+
+	return json;
 }
 
 void Scheduler::setCommandModeOptions(json value)
@@ -156,7 +344,92 @@ bool Scheduler::checkSpawnPoints(int spawnPoints, string coalition)
 	return false;
 }
 
-void Scheduler::handleRequest(string key, json value, string username, json &answer)
+/* Called by the server threads. The request is only queued, it is handled on the simulation thread by handleRequests. Returns the hash of the request,
+	which is also the hash of the command it generates, if any */
+string Scheduler::enqueueRequest(string key, json value, string username)
+{
+	string hash = random_string(16);
+	pendingRequests++;
+	requests.push({ key, value, username, hash });
+	return hash;
+}
+
+void Scheduler::setCommandExecuted(const string &commandHash)
+{
+	setCommandFinished(commandHash, CommandStatus::EXECUTED);
+}
+
+/* The command could not run, or the request was rejected. The callback is not executed */
+void Scheduler::setCommandFailed(const string &commandHash)
+{
+	setCommandFinished(commandHash, CommandStatus::FAILED);
+}
+
+/* Remembers the final status of a command. Only the last SCHEDULER_EXECUTED_HISTORY_SIZE hashes are kept */
+void Scheduler::setCommandFinished(const string &commandHash, int status)
+{
+	if (finishedCommands.emplace(commandHash, status).second)
+		rememberCommand(commandHash);
+}
+
+/* The request was discarded as a duplicate of a queued command, and reports the status of that command */
+void Scheduler::setCommandAlias(const string &commandHash, const string &queuedHash)
+{
+	if (commandAliases.emplace(commandHash, queuedHash).second)
+		rememberCommand(commandHash);
+}
+
+void Scheduler::rememberCommand(const string &commandHash)
+{
+	finishedCommandsHistory.push_back(commandHash);
+	if (finishedCommandsHistory.size() > SCHEDULER_EXECUTED_HISTORY_SIZE)
+	{
+		finishedCommands.erase(finishedCommandsHistory.front());
+		commandAliases.erase(finishedCommandsHistory.front());
+		finishedCommandsHistory.pop_front();
+	}
+}
+
+/* Status of the command, see CommandStatus. A hash which is neither queued nor in the history of the finished commands is unknown: it was never issued, or it expired from
+	the history. While the inbox is not empty, unknown hashes are reported as pending, since they may belong to a request which is not handled yet */
+int Scheduler::getCommandStatus(const string &requestHash)
+{
+	auto alias = commandAliases.find(requestHash);
+	const string &commandHash = alias != commandAliases.end() ? alias->second : requestHash;
+
+	auto finished = finishedCommands.find(commandHash);
+	if (finished != finishedCommands.end())
+		return finished->second;
+	if (queuedCommandsHashes.find(commandHash) != queuedCommandsHashes.end() || pendingRequests > 0)
+		return CommandStatus::PENDING;
+	return CommandStatus::UNKNOWN;
+}
+
+/* Handles the queued requests, within the SCHEDULER_REQUESTS_BUDGET time budget. Called on the simulation thread, under the global lock */
+void Scheduler::handleRequests()
+{
+	const auto start = steady_clock::now();
+
+	PendingRequest request;
+	while (requests.pop(request))
+	{
+		pendingRequests--;
+		try
+		{
+			handleRequest(request.key, request.value, request.username, request.hash);
+		}
+		catch (const exception &e)
+		{
+			log("Error handling request " + request.key + ": " + e.what());
+			setCommandFailed(request.hash);
+		}
+
+		if (duration_cast<microseconds>(steady_clock::now() - start).count() > SCHEDULER_REQUESTS_BUDGET)
+			break;
+	}
+}
+
+void Scheduler::handleRequest(string key, json value, string username, string hash)
 {
 	Command *command = nullptr;
 
@@ -212,7 +485,10 @@ void Scheduler::handleRequest(string key, json value, string username, json &ans
 
 		int spawnPoints = value["spawnPoints"].template get<int32_t>();
 		if (!checkSpawnPoints(spawnPoints, coalition))
+		{
+			setCommandFailed(hash);
 			return;
+		}
 
 		vector<SpawnOptions> spawnOptions;
 		for (auto &unit : value["units"])
@@ -247,7 +523,10 @@ void Scheduler::handleRequest(string key, json value, string username, json &ans
 
 		int spawnPoints = value["spawnPoints"].template get<int32_t>();
 		if (!checkSpawnPoints(spawnPoints, coalition))
+		{
+			setCommandFailed(hash);
 			return;
+		}
 
 		vector<SpawnOptions> spawnOptions;
 		for (auto &unit : value["units"])
@@ -755,12 +1034,22 @@ void Scheduler::handleRequest(string key, json value, string username, json &ans
 	else
 	{
 		log("Unknown command: " + key);
+		setCommandFailed(hash);
+		return;
 	}
 
 	if (command != nullptr)
 	{
-		appendCommand(command);
-		log("New command appended correctly to stack. Current server load: " + to_string(getLoad()));
-		answer["commandHash"] = (to_wstring(command->getHash()));
+		command->setHash(hash);
+		string queuedHash;
+		if (appendCommand(command, &queuedHash))
+			log("New command appended correctly to stack. Current server load: " + to_string(getLoad()));
+		else
+			setCommandAlias(hash, queuedHash);	/* The same command is already queued, the request gets its status */
+	}
+	else
+	{
+		/* Requests which do not generate a command are done as soon as they are handled */
+		setCommandExecuted(hash);
 	}
 }
@@ -5,9 +5,14 @@
 #include "weaponsManager.h"
 #include "scheduler.h"
 #include "luatools.h"
+#include "bytebuffer.h"
+#include "compression.h"
+#include "datasnapshot.h"
 #include <exception>
 #include <stdexcept>
 #include <chrono>
+#include <atomic>
+#include <random>
 
 using namespace std::chrono;
 
@@ -41,22 +46,20 @@ crow::response Server::handle_put(const crow::request &req)
     // TODO: limit what a user can do depending on the role
     auto &ctxAuth = app.get_context<AuthMiddleware>(req);
 
+    /* The requests are parsed here and only queued, the scheduler handles them on the simulation thread. The hash of the last request is returned as
+    the handle of the command, see handle_get_command */
     auto answer = json::object();
     auto res = json::parse(req.body);
     if (res.is_object())
     {
-        lock_guard<mutex> guard(mutexLock);
-
         for (auto const &e : res.items())
         {
-            try
-            {
-                scheduler->handleRequest(e.key(), e.value(), ctxAuth.username, answer);
-            }
-            catch (...)
+            if (!e.value().is_object())
             {
-                handle_eptr(std::current_exception());
+                log("Invalid request " + e.key() + ", the value must be an object");
+                continue;
             }
+            answer["commandHash"] = scheduler->enqueueRequest(e.key(), e.value(), ctxAuth.username);
         }
     }
 
@@ -83,11 +86,71 @@ unsigned long long Server::extract_reference_time(const crow::request& req) {
     }
 }
 
+/* Version of the binary protocol requested by the client, see DataProtocol */
+unsigned char Server::extract_protocol(const crow::request& req) {
+    if (req.url_params.get("protocol") == nullptr)
+    {
+        return DataProtocol::standard;
+    }
+
+    int protocol = atoi(req.url_params.get("protocol"));
+    if (protocol < DataProtocol::standard || protocol > DataProtocol::lastProtocol)
+    {
+        return DataProtocol::standard;
+    }
+    return static_cast<unsigned char>(protocol);
+}
+
+/* Comma separated list of the DataIndex values requested by the client. All the data is sent if the list is missing */
+unsigned long long Server::extract_fields(const crow::request& req) {
+    if (req.url_params.get("fields") == nullptr)
+    {
+        return ~0ULL;
+    }
+
+    unsigned long long fields = 0;
+    stringstream ss(req.url_params.get("fields"));
+    string field;
+    while (getline(ss, field, ','))
+    {
+        int datumIndex = atoi(field.c_str());
+        if (datumIndex > DataIndex::startOfData && datumIndex < DataIndex::lastIndex)
+            fields |= 1ULL << datumIndex;
+    }
+    return fields;
+}
+
+/* Area of the units request, either bbox=minLat,minLng,maxLat,maxLng or center=lat,lng and radius in meters. Malformed areas are ignored. A delta
+request also gives the area of the request which returned its reference version, with referenceBbox, or referenceCenter and referenceRadius */
+DataArea Server::extract_area(const crow::request& req, const char* bboxParam, const char* centerParam, const char* radiusParam) {
+    DataArea area;
+    auto parse = [](const char* value, vector<double>& numbers) {
+        stringstream ss(value);
+        string number;
+        while (getline(ss, number, ','))
+            numbers.push_back(atof(number.c_str()));
+    };
+
+    vector<double> numbers;
+    if (req.url_params.get(bboxParam) != nullptr)
+    {
+        parse(req.url_params.get(bboxParam), numbers);
+        if (numbers.size() == 4)
+            area.setBox(numbers[0], numbers[1], numbers[2], numbers[3]);
+    }
+    else if (req.url_params.get(centerParam) != nullptr && req.url_params.get(radiusParam) != nullptr)
+    {
+        parse(req.url_params.get(centerParam), numbers);
+        double radius = atof(req.url_params.get(radiusParam));
+        if (numbers.size() == 2 && radius > 0)
+            area.setCircle({ numbers[0], numbers[1] }, radius);
+    }
+    return area;
+}
+
 crow::response Server::handle_get_logs(const crow::request& req)
 {
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
-
+    /* The logger has its own lock, the global one is not needed */
     try
     {
         auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
@@ -211,7 +274,47 @@ crow::response Server::handle_get_command(const crow::request& req) {
             return res;
         }
 
-        data["commandExecuted"] = scheduler->isCommandExecuted(req.url_params.get("commandHash"));
+        /* Unknown commands were never issued, or are too old to be remembered, see SCHEDULER_EXECUTED_HISTORY_SIZE */
+        int status = scheduler->getCommandStatus(req.url_params.get("commandHash"));
+        data["commandExecuted"] = status == CommandStatus::EXECUTED;
+        switch (status)
+        {
+        case CommandStatus::EXECUTED:
+            data["commandStatus"] = "executed";
+            break;
+        case CommandStatus::PENDING:
+            data["commandStatus"] = "pending";
+            break;
+        case CommandStatus::FAILED:
+            data["commandStatus"] = "failed";
+            break;
+        case CommandStatus::SUPERSEDED:
+            data["commandStatus"] = "superseded";
+            break;
+        default:
+            data["commandStatus"] = "unknown";
+            break;
+        }
+
+        return create_general_response(data, ms);
+    }
+    catch (...)
+    {
+        return handle_eptr(std::current_exception());
+    }
+}
+
+/* Measured execution cost of the command types, see Scheduler::getCostStatistics */
+crow::response Server::handle_get_scheduler(const crow::request& req) {
+    /* Lock for thread safety */
+    lock_guard<mutex> guard(mutexLock);
+
+    try
+    {
+        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        auto data = json::object();
+
+        data["scheduler"] = scheduler->getCostStatistics();
 
         return create_general_response(data, ms);
     }
@@ -221,6 +324,39 @@ crow::response Server::handle_get_command(const crow::request& req) {
     }
 }
 
+/* Browsers can not set headers on a WebSocket, so the data stream is opened with a token issued here to an authenticated client. The token is only
+    valid once and for STREAM_TOKEN_LIFETIME seconds, so that the credentials are never part of a URL, which would end up in the log */
+crow::response Server::handle_get_stream_token(const crow::request& req) {
+    /* Lock for thread safety */
+    lock_guard<mutex> guard(mutexLock);
+
+    try
+    {
+        auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        auto data = json::object();
+
+        static random_device randomDevice;
+        static const char hexDigits[] = "0123456789abcdef";
+        string token;
+        for (int i = 0; i < 32; i++)
+            token += hexDigits[randomDevice() % 16];
+
+        {
+            lock_guard<mutex> tokensGuard(streamTokensLock);
+            const auto now = steady_clock::now();
+            for (auto it = streamTokens.begin(); it != streamTokens.end();)
+                it = it->second.expiry < now ? streamTokens.erase(it) : next(it);
+            streamTokens[token] = { app.get_context<AuthMiddleware>(req).role, now + seconds(STREAM_TOKEN_LIFETIME) };
+        }
+
+        data["token"] = token;
+        return create_general_response(data, ms);
+    }
+    catch (...)
+    {
+        return handle_eptr(std::current_exception());
+    }
+}
 
 crow::response Server::create_general_response(json& data, const std::chrono::milliseconds ms) {
     auto res = crow::response(crow::OK);
@@ -240,26 +376,13 @@ crow::response Server::create_general_response(json& data, const std::chrono::mi
 
 crow::response Server::handle_get_units(const crow::request &req)
 {
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
-
-    auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-    
     try
     {
-        auto response = crow::response(crow::OK);
-
-        auto time = extract_reference_time(req);
-        unsigned long long updateTime = ms.count();
-
-        stringstream ss;
-        ss.write((char*)&updateTime, sizeof(updateTime));
-        unitsManager->getUnitData(ss, time);
-        response.body = ss.str();
-
-        log("Unit response: " + response.body);
-
-        return response;
+        return create_data_response(req, unitsResponseCache, unitsResponseSize, "Unit", [](ByteBuffer& buffer, const DataRequest& request, const DataSnapshot& snapshot) {
+            if (request.time == 0)
+                DataSnapshot::requestLeaderRefresh();
+            snapshot.getUnitData(buffer, request);
+        });
     }
     catch (...)
     {
@@ -269,33 +392,185 @@ crow::response Server::handle_get_units(const crow::request &req)
 
 crow::response Server::handle_get_weapons(const crow::request& req)
 {
-    /* Lock for thread safety */
-    lock_guard<mutex> guard(mutexLock);
+    try
+    {
+        return create_data_response(req, weaponsResponseCache, weaponsResponseSize, "Weapons", [](ByteBuffer& buffer, const DataRequest& request, const DataSnapshot& snapshot) {
+            snapshot.getWeaponData(buffer, request);
+        });
+    }
+    catch (...)
+    {
+        return handle_eptr(std::current_exception());
+    }
+}
+
+/* Binary data response, compressed with the best encoding accepted by the client. The data is read from the latest snapshot, so the global lock is
+not taken and the simulation never waits for the server. Compressed bodies are cached for the snapshot version, so that the clients polling the same
+tick share a single serialization and compression pass */
+crow::response Server::create_data_response(const crow::request& req, CompressedResponseCache& cache, atomic<size_t>& responseSize, const string& name, function<void(ByteBuffer&, const DataRequest&, const DataSnapshot&)> getData)
+{
+    auto response = crow::response(crow::OK);
+    response.set_header("Vary", "Accept-Encoding");
+
+    /* The reference time is the data version returned by the previous request, see dataVersion */
+    DataRequest request;
+    request.time = extract_reference_time(req);
+    request.protocol = extract_protocol(req);
+    request.fields = extract_fields(req);
+    request.area = extract_area(req, "bbox", "center", "radius");
+    request.referenceArea = extract_area(req, "referenceBbox", "referenceCenter", "referenceRadius");
+    request.coalition = get_coalition(app.get_context<AuthMiddleware>(req).role);
+    ContentEncoding encoding = negotiateContentEncoding(req.get_header_value("Accept-Encoding"));
+    string key = to_string(request.time) + "/" + to_string(request.protocol) + "/" + to_string(request.fields) + "/" + getContentEncodingName(encoding);
+    key += "/" + to_string(request.coalition);
+    for (auto param : { "bbox", "center", "radius", "referenceBbox", "referenceCenter", "referenceRadius" })
+        if (req.url_params.get(param) != nullptr)
+            key += "/" + string(param) + "=" + string(req.url_params.get(param));
+
+    /* The snapshot is kept alive by this request until the response is built, even if a newer one is published meanwhile */
+    auto snapshot = DataSnapshot::getLatest();
+    const unsigned long long updateTime = snapshot->version;
+
+    /* A cached body was serialized from the same snapshot */
+    if (encoding != ContentEncoding::identity && cache.get(updateTime, key, response.body))
+    {
+        response.set_header("Content-Encoding", getContentEncodingName(encoding));
+        return response;
+    }
 
-    auto ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+    /* Reserve the size of the last response, so that the buffer does not need to grow while writing */
+    ByteBuffer buffer(responseSize);
+    buffer.write(updateTime);
+    getData(buffer, request, *snapshot);
+    responseSize = buffer.size();
+    response.body = buffer.release();
 
-    try
+    log(name + " response: " + to_string(response.body.size()) + " bytes");
+
+    if (compressResponseBody(response.body, encoding))
     {
-        auto response = crow::response(crow::OK);
+        cache.put(updateTime, key, response.body);
+        response.set_header("Content-Encoding", getContentEncodingName(encoding));
+    }
 
-        auto time = extract_reference_time(req);
-        unsigned long long updateTime = ms.count();
+    return response;
+}
 
-        stringstream ss;
-        ss.write((char*)&updateTime, sizeof(updateTime));
-        weaponsManager->getWeaponData(ss, time);
-        response.body = ss.str();
+/* Pushes the data changed since the last tick to the data stream subscribers. The messages are built once for each coalition of the subscribers, and
+sent to all the subscribers of that coalition. Called by the ingest worker after each data tick */
+void Server::publishData()
+{
+    lock_guard<mutex> streamGuard(streamLock);
+    if (streamSubscribers.empty() && newStreamSubscribers.empty())
+        return;
 
-        log("Weapons response: " + response.body);
+    /* Units and weapons messages, by coalition */
+    map<int, pair<string, string>> deltas;
+    map<int, pair<string, string>> refreshes;
+    for (auto connection : streamSubscribers)
+        deltas[get_stream_coalition(connection)];
+    for (auto connection : newStreamSubscribers)
+        refreshes[get_stream_coalition(connection)];
+
+    /* The deltas and the full refreshes are built from the same snapshot, so that the new subscribers do not miss any change */
+    auto snapshot = DataSnapshot::getLatest();
+    const unsigned long long updateTime = snapshot->version;
+    if (updateTime == lastPublishedVersion)
+        deltas.clear();
+    if (deltas.empty() && refreshes.empty())
+        return;
 
-        return response;
+    auto build = [this, &snapshot, updateTime](pair<string, string>& messages, int coalition, unsigned long long time) {
+        DataRequest request;
+        request.time = time;
+        request.coalition = coalition;
+
+        ByteBuffer units(unitsResponseSize);
+        units.write(static_cast<unsigned char>(DataStreamMessage::units));
+        units.write(updateTime);
+        snapshot->getUnitData(units, request);
+
+        ByteBuffer weapons(weaponsResponseSize);
+        weapons.write(static_cast<unsigned char>(DataStreamMessage::weapons));
+        weapons.write(updateTime);
+        snapshot->getWeaponData(weapons, request);
+
+        messages = make_pair(units.release(), weapons.release());
+    };
+
+    for (auto& delta : deltas)
+        build(delta.second, delta.first, lastPublishedVersion);
+    if (!refreshes.empty())
+        DataSnapshot::requestLeaderRefresh();
+    for (auto& refresh : refreshes)
+        build(refresh.second, refresh.first, 0);
+    lastPublishedVersion = updateTime;
+
+    if (!deltas.empty())
+    {
+        for (auto connection : streamSubscribers)
+        {
+            auto& messages = deltas[get_stream_coalition(connection)];
+            connection->send_binary(messages.first);
+            connection->send_binary(messages.second);
+        }
     }
-    catch (...)
+
+    for (auto connection : newStreamSubscribers)
     {
-        return handle_eptr(std::current_exception());
+        auto& messages = refreshes[get_stream_coalition(connection)];
+        connection->send_binary(messages.first);
+        connection->send_binary(messages.second);
+        streamSubscribers.insert(connection);
+    }
+    newStreamSubscribers.clear();
+}
+
+/* Coalition whose units a role can see, -1 for all the units */
+int Server::get_coalition(AuthRole role)
+{
+    switch (role)
+    {
+    case AuthRole::BlueCommander:
+        return 2;
+    case AuthRole::RedCommander:
+        return 1;
+    default:
+        return -1;
     }
 }
 
+/* The coalition of a subscriber is stored in the connection userdata, offset by one so that it is never null */
+int Server::get_stream_coalition(crow::websocket::connection* connection)
+{
+    return static_cast<int>(reinterpret_cast<intptr_t>(connection->userdata())) - 1;
+}
+
+/* Clients which can set headers authenticate as for the REST API, browsers pass a token from /olympus/stream/token in the token parameter */
+bool Server::accept_stream(const crow::request& req, void** userdata)
+{
+    AuthMiddleware::context ctx;
+    app.get_middleware<AuthMiddleware>().authenticate(req.get_header_value("Authorization"), ctx);
+
+    if (!ctx.isAuth && req.url_params.get("token") != nullptr)
+    {
+        lock_guard<mutex> guard(streamTokensLock);
+        auto it = streamTokens.find(req.url_params.get("token"));
+        if (it != streamTokens.end())
+        {
+            if (it->second.expiry >= steady_clock::now())
+            {
+                ctx.role = it->second.role;
+                ctx.isAuth = ctx.role != AuthRole::Guest;
+            }
+            streamTokens.erase(it);
+        }
+    }
+
+    *userdata = reinterpret_cast<void*>(static_cast<intptr_t>(get_coalition(ctx.role) + 1));
+    return ctx.isAuth;
+}
+
 void Server::initWebServer()
 {
     string jsonLocation = instancePath + OLYMPUS_JSON_PATH;
@@ -392,6 +667,23 @@ void Server::initWebServer()
         CROW_ROUTE(app, "/olympus/commands")
             .CROW_MIDDLEWARES(app, AuthMiddleware, AuthRequiredMiddleware)
             .methods(crow::HTTPMethod::Get)([this](const crow::request& req) { return handle_get_command(req); });
+        CROW_ROUTE(app, "/olympus/scheduler")
+            .CROW_MIDDLEWARES(app, AuthMiddleware, AuthRequiredMiddleware)
+            .methods(crow::HTTPMethod::Get)([this](const crow::request& req) { return handle_get_scheduler(req); });
+        CROW_ROUTE(app, "/olympus/stream/token")
+            .CROW_MIDDLEWARES(app, AuthMiddleware, AuthRequiredMiddleware)
+            .methods(crow::HTTPMethod::Get)([this](const crow::request& req) { return handle_get_stream_token(req); });
+        CROW_WEBSOCKET_ROUTE(app, "/olympus/stream")
+            .onaccept([this](const crow::request& req, void** userdata) { return accept_stream(req, userdata); })
+            .onopen([this](crow::websocket::connection& connection) {
+                lock_guard<mutex> guard(streamLock);
+                newStreamSubscribers.insert(&connection);
+            })
+            .onclose([this](crow::websocket::connection& connection, const string& reason) {
+                lock_guard<mutex> guard(streamLock);
+                streamSubscribers.erase(&connection);
+                newStreamSubscribers.erase(&connection);
+            });
 
         log("Going to start backend on " + address + ":" + to_string(port));
         serverJob = app.bindaddr(address == "localhost" ? "127.0.0.1" : address).port(port).run_async();
@@ -11,7 +11,12 @@ void AuthMiddleware::before_handle(crow::request& req, crow::response& res, cont
     if (it == req.headers.end())
         return;
 
-    string authorization = it->second;
+    authenticate(it->second, ctx);
+}
+
+/* Parses a Basic authorization value and grants the role matching the password */
+void AuthMiddleware::authenticate(string authorization, context& ctx)
+{
     string s = "Basic ";
     string::size_type i = authorization.find(s);
     if (i == std::string::npos)
@@ -0,0 +1,282 @@
+#include "spatialindex.h"
+#include "unit.h"
+#include "geodesy.h"
+
+#include <GeographicLib/Geodesic.hpp>
+using namespace GeographicLib;
+
+#define METERS_PER_DEGREE_LAT 110574.0	/* Smallest length of a degree of latitude (at the equator) */
+#define METERS_PER_DEGREE_LNG 111320.0	/* Length of a degree of longitude at the equator */
+
+int SpatialIndex::getPartition(unsigned char coalition, const string &category)
+{
+	if (coalition >= coalitionsCount)
+		return -1;
+
+	int categoryIndex = -1;
+	if (category.compare("Aircraft") == 0)
+		categoryIndex = 0;
+	else if (category.compare("Helicopter") == 0)
+		categoryIndex = 1;
+	else if (category.compare("GroundUnit") == 0)
+		categoryIndex = 2;
+	else if (category.compare("NavyUnit") == 0)
+		categoryIndex = 3;
+	else
+		return -1;
+
+	return coalition * categoriesCount + categoryIndex;
+}
+
+/* Conservative (smallest) extent in meters of a cell, within the given number of rings around the cell containing lat */
+double SpatialIndex::getMinCellExtent(double lat, int rings)
+{
+	const double maxLat = min(89.0, abs(lat) + (rings + 1) * SPATIAL_INDEX_CELL_SIZE);
+	const double latExtent = SPATIAL_INDEX_CELL_SIZE * METERS_PER_DEGREE_LAT;
+	const double lngExtent = SPATIAL_INDEX_CELL_SIZE * METERS_PER_DEGREE_LNG * cos(maxLat / 57.29577);
+	return min(latExtent, lngExtent) * (1 - SPATIAL_INDEX_TOLERANCE);
+}
+
+vector<int> SpatialIndex::getPartitions(unsigned char coalition, const vector<string> &categories)
+{
+	vector<int> partitions;
+	for (auto const &category : categories)
+	{
+		int partition = getPartition(coalition, category);
+		if (partition >= 0 && find(partitions.begin(), partitions.end(), partition) == partitions.end())
+			partitions.push_back(partition);
+	}
+	return partitions;
+}
+
+/* Inserts, moves or removes the unit depending on its current position, coalition, category and alive state. Only alive units are indexed */
+void SpatialIndex::update(Unit *unit)
+{
+	Location newLocation;
+	if (unit->getAlive())
+	{
+		newLocation.partition = getPartition(unit->getCoalition(), unit->getCategory());
+		newLocation.cell = getCellKey(unit->getPosition());
+	}
+
+	auto it = locations.find(unit);
+	if (it != locations.end())
+	{
+		if (it->second.partition == newLocation.partition && it->second.cell == newLocation.cell)
+			return;
+		removeFromCell(unit, it->second);
+	}
+
+	if (newLocation.partition < 0)
+	{
+		if (it != locations.end())
+			locations.erase(it);
+		return;
+	}
+
+	cells[newLocation.partition][newLocation.cell].push_back(unit);
+	sizes[newLocation.partition]++;
+	locations[unit] = newLocation;
+}
+
+bool SpatialIndex::isCellInArea(const DataArea &area, long long key)
+{
+	const int latIndex = static_cast<int>(key >> 32);
+	const int lngIndex = static_cast<int>(key & 0xFFFFFFFF);
+	const double minLat = latIndex * SPATIAL_INDEX_CELL_SIZE;
+	const double minLng = lngIndex * SPATIAL_INDEX_CELL_SIZE;
+	const double maxLat = minLat + SPATIAL_INDEX_CELL_SIZE;
+	const double maxLng = minLng + SPATIAL_INDEX_CELL_SIZE;
+	return area.contains({ minLat, minLng }) && area.contains({ minLat, maxLng }) &&
+		area.contains({ maxLat, minLng }) && area.contains({ maxLat, maxLng });
+}
+
+bool SpatialIndex::isCellOverlappingArea(const DataArea &area, long long key)
+{
+	const int latIndex = static_cast<int>(key >> 32);
+	const int lngIndex = static_cast<int>(key & 0xFFFFFFFF);
+	return latIndex >= getCellIndex(area.minLat) && latIndex <= getCellIndex(area.maxLat) &&
+		lngIndex >= getCellIndex(area.minLng) && lngIndex <= getCellIndex(area.maxLng);
+}
+
+void SpatialIndex::removeFromCell(Unit *unit, const Location &location)
+{
+	auto it = cells[location.partition].find(location.cell);
+	if (it == cells[location.partition].end())
+		return;
+
+	vector<Unit *> &cellUnits = it->second;
+	auto position = find(cellUnits.begin(), cellUnits.end(), unit);
+	if (position != cellUnits.end())
+	{
+		*position = cellUnits.back();
+		cellUnits.pop_back();
+		sizes[location.partition]--;
+	}
+
+	if (cellUnits.empty())
+		cells[location.partition].erase(it);
+}
+
+template <typename Visitor>
+void SpatialIndex::visitCell(const vector<int> &partitions, int latIndex, int lngIndex, Visitor visitor)
+{
+	const long long key = getCellKey(latIndex, lngIndex);
+	for (auto const &partition : partitions)
+	{
+		auto it = cells[partition].find(key);
+		if (it != cells[partition].end())
+			for (auto const &unit : it->second)
+				visitor(unit);
+	}
+}
+
+template <typename Visitor>
+void SpatialIndex::visitAll(const vector<int> &partitions, Visitor visitor)
+{
+	for (auto const &partition : partitions)
+		for (auto const &cell : cells[partition])
+			for (auto const &unit : cell.second)
+				visitor(unit);
+}
+
+/* Finds the closest alive unit of the given coalition and categories. The rings of cells around the unit are visited until no unvisited unit can be
+	closer than the best candidate. If the search would visit more cells than there are units, the partitions are scanned instead */
+Unit *SpatialIndex::getClosestUnit(Unit *unit, unsigned char coalition, const vector<string> &categories, double &distance)
+{
+	distance = 0;
+
+	vector<int> partitions = getPartitions(coalition, categories);
+	size_t total = 0;
+	for (auto const &partition : partitions)
+		total += sizes[partition];
+	if (total == 0)
+		return nullptr;
+
+	const Coords origin = unit->getPosition();
+	const LocalTangentPlane plane(origin);
+	const int latIndex = getCellIndex(origin.lat);
+	const int lngIndex = getCellIndex(origin.lng);
+
+	vector<pair<Unit *, double>> candidates;
+	double bestApproximation = numeric_limits<double>::max();
+	auto collect = [&](Unit *candidate)
+	{
+		/* Out of the bounds of the approximation (far away or near the poles), the exact distance is used instead */
+		const Coords position = candidate->getPosition();
+		double approximation = plane.getApproximateDistance(position);
+		if (!plane.isApproximationValid(position, approximation))
+			approximation = geodesicDistance(origin, position);
+		candidates.push_back(make_pair(candidate, approximation));
+		bestApproximation = min(bestApproximation, approximation);
+	};
+
+	size_t visitedCells = 0;
+	for (int ring = 0;; ring++)
+	{
+		const size_t ringCells = ring == 0 ? 1 : 8 * ring;
+		if (visitedCells + ringCells > total)
+		{
+			candidates.clear();
+			bestApproximation = numeric_limits<double>::max();
+			visitAll(partitions, collect);
+			break;
+		}
+
+		if (ring == 0)
+			visitCell(partitions, latIndex, lngIndex, collect);
+		else
+		{
+			for (int j = -ring; j <= ring; j++)
+			{
+				visitCell(partitions, latIndex - ring, lngIndex + j, collect);
+				visitCell(partitions, latIndex + ring, lngIndex + j, collect);
+			}
+			for (int i = -ring + 1; i < ring; i++)
+			{
+				visitCell(partitions, latIndex + i, lngIndex - ring, collect);
+				visitCell(partitions, latIndex + i, lngIndex + ring, collect);
+			}
+		}
+		visitedCells += ringCells;
+
+		/* Any unit outside of the visited rings is at least ring cells away from the origin */
+		if (!candidates.empty() && ring * getMinCellExtent(origin.lat, ring) > bestApproximation * (1 + SPATIAL_INDEX_TOLERANCE))
+			break;
+	}
+
+	/* Exact refinement, only on the candidates which may be the closest given the approximation error */
+	Unit *closestUnit = nullptr;
+	double closestDistance = 0;
+	for (auto const &candidate : candidates)
+	{
+		if (candidate.second > bestApproximation * (1 + 2 * SPATIAL_INDEX_TOLERANCE) + 1)
+			continue;
+
+		double dist;
+		Coords position = candidate.first->getPosition();
+		Geodesic::WGS84().Inverse(origin.lat, origin.lng, position.lat, position.lng, dist);
+		if (closestUnit == nullptr || dist < closestDistance)
+		{
+			closestUnit = candidate.first;
+			closestDistance = dist;
+		}
+	}
+
+	if (closestUnit != nullptr)
+	{
+		double altDelta = origin.alt - closestUnit->getPosition().alt;
+		distance = sqrt(closestDistance * closestDistance + altDelta * altDelta);
+	}
+
+	return closestUnit;
+}
+
+/* Finds all the alive units of the given coalition and categories within range. Only the cells overlapping the range are visited, and the exact geodesic
+	is only computed for the units the approximation can not rule out */
+map<Unit *, double> SpatialIndex::getUnitsInRange(Unit *unit, unsigned char coalition, const vector<string> &categories, double range)
+{
+	map<Unit *, double> unitsInRange;
+
+	vector<int> partitions = getPartitions(coalition, categories);
+	size_t total = 0;
+	for (auto const &partition : partitions)
+		total += sizes[partition];
+	if (total == 0)
+		return unitsInRange;
+
+	const Coords origin = unit->getPosition();
+	const LocalTangentPlane plane(origin);
+	auto check = [&](Unit *candidate)
+	{
+		Coords position = candidate->getPosition();
+		/* The approximation only rules out the candidate within its bounds, otherwise the exact distance decides */
+		const double approximation = plane.getApproximateDistance(position);
+		if (plane.isApproximationValid(position, approximation) && approximation > range * (1 + SPATIAL_INDEX_TOLERANCE) + 1)
+			return;
+
+		double dist;
+		Geodesic::WGS84().Inverse(origin.lat, origin.lng, position.lat, position.lng, dist);
+		if (dist <= range)
+			unitsInRange[candidate] = dist;
+	};
+
+	/* Number of cells to visit on each side of the origin cell */
+	const double maxLat = min(89.0, abs(origin.lat) + range / METERS_PER_DEGREE_LAT + SPATIAL_INDEX_CELL_SIZE);
+	const int latSpan = static_cast<int>(ceil(range / (SPATIAL_INDEX_CELL_SIZE * METERS_PER_DEGREE_LAT * (1 - SPATIAL_INDEX_TOLERANCE))));
+	const int lngSpan = static_cast<int>(ceil(range / (SPATIAL_INDEX_CELL_SIZE * METERS_PER_DEGREE_LNG * cos(maxLat / 57.29577) * (1 - SPATIAL_INDEX_TOLERANCE))));
+
+	const double cellsCount = (2.0 * latSpan + 1) * (2.0 * lngSpan + 1);
+	if (cellsCount > total)
+		visitAll(partitions, check);
+	else
+	{
+		const int latIndex = getCellIndex(origin.lat);
+		const int lngIndex = getCellIndex(origin.lng);
+		for (int i = -latSpan; i <= latSpan; i++)
+			for (int j = -lngSpan; j <= lngSpan; j++)
+				visitCell(partitions, latIndex + i, lngIndex + j, check);
+	}
+
+	return unitsInRange;
+}
@@ -2,18 +2,19 @@
 #include "utils.h"
 #include "logger.h"
 #include "commands.h"
+#include "luawriter.h"
 #include "scheduler.h"
 #include "defines.h"
 #include "unitsmanager.h"
+#include "geodesy.h"
 
 #include <chrono>
+#include <atomic>
 using namespace std::chrono;
 
-#include <GeographicLib/Geodesic.hpp>
-using namespace GeographicLib;
-
 extern Scheduler *scheduler;
 extern UnitsManager *unitsManager;
+extern atomic<unsigned long long> dataVersion;
 
 Unit::Unit(json json, unsigned int ID) : ID(ID)
 {
@@ -155,6 +156,66 @@ void Unit::update(json json, double dt)
 	runAILoop();
 }
 
+/* Counterpart of initialize(json) for the frames captured by the ingest pipeline */
+void Unit::initialize(const UnitFrame &frame)
+{
+	setName(frame.name);
+
+	if (frame.hasControllerData)
+	{
+		setUnitName(frame.unitName);
+		setGroupName(frame.groupName);
+	}
+
+	setCoalition(frame.coalition);
+
+	/* All units which contain the name "Olympus" are automatically under AI control */
+	if (getUnitName().find("Olympus") != string::npos)
+		setControlled(true);
+
+	update(frame, 0);
+	setDefaults();
+}
+
+/* Counterpart of update(json, dt) for the frames captured by the ingest pipeline. Runs on the ingest worker thread, under the global lock.
+	Strings are compared with the stored values first, so that they are only copied if they actually changed */
+void Unit::update(const UnitFrame &frame, double dt)
+{
+	if (!frame.full)
+	{
+		/* The unit no longer exists */
+		setAlive(false);
+		runAILoop();
+		return;
+	}
+
+	setPosition(frame.position);
+	setHeading(frame.heading);
+	setTrack(frame.track);
+	setSpeed(frame.speed);
+	setHorizontalVelocity(frame.horizontalVelocity);
+	setVerticalVelocity(frame.verticalVelocity);
+	setAlive(frame.alive);
+
+	if (frame.hasControllerData)
+	{
+		if (unitName != frame.unitName)
+			setUnitName(frame.unitName);
+
+		if (groupName != frame.groupName)
+			setGroupName(frame.groupName);
+
+		setHuman(frame.human);
+		setHasTask(frame.hasTask);
+		setFuel(short(frame.fuel * 100));
+		setHealth(static_cast<unsigned char>(frame.health));
+		setAmmo(frame.ammo);
+		setContacts(frame.contacts);
+	}
+
+	runAILoop();
+}
+
 void Unit::setDefaults(bool force)
 {
 }
@@ -176,10 +237,9 @@ void Unit::runAILoop()
 		AIloop();
 	}
 
-	refreshLeaderData(lastLoopTime);
+	refreshLeaderData(lastLoopVersion);
 
-	milliseconds ms = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-	lastLoopTime = ms.count();
+	lastLoopVersion = dataVersion.load();
 }
 
 void Unit::refreshLeaderData(unsigned long long time)
@@ -188,7 +248,7 @@ void Unit::refreshLeaderData(unsigned long long time)
 	if (!getIsLeader())
 	{
 		Unit *leader = unitsManager->getGroupLeader(this);
-		if (leader != nullptr)
+		if (leader != nullptr && leader->hasFreshData(time))
 		{
 			for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
 			{
@@ -283,184 +343,303 @@ void Unit::refreshLeaderData(unsigned long long time)
 
 bool Unit::checkFreshness(unsigned char datumIndex, unsigned long long time)
 {
-	auto it = updateTimeMap.find(datumIndex);
-	if (it == updateTimeMap.end())
-		return false;
-	else
-		return it->second > time;
+	return datumIndex < DataIndex::lastIndex && updateVersions[datumIndex] > time;
 }
 
 bool Unit::hasFreshData(unsigned long long time)
 {
-	for (auto it : updateTimeMap)
-		if (it.second > time)
-			return true;
-	return false;
+	return lastUpdateVersion > time;
 }
 
-void Unit::getData(stringstream &ss, unsigned long long time)
+void Unit::getData(ByteBuffer &buffer, const DataRequest &request)
 {
 	/* When an update is requested, make sure data is refreshed */
-	if (time == 0)
+	if (request.time == 0)
 		refreshLeaderData(0);
 
+	/* Units with nothing new are skipped entirely */
+	if (request.time != 0 && !hasFreshData(request.time))
+		return;
+
 	const unsigned char endOfData = DataIndex::endOfData;
-	ss.write((const char *)&ID, sizeof(ID));
-	if (!alive && time == 0)
+	const size_t start = buffer.size();
+	buffer.write(ID);
+	if (!alive && request.time == 0)
 	{
-		unsigned char datumIndex = DataIndex::category;
-		appendString(ss, datumIndex, category);
-		datumIndex = DataIndex::alive;
-		appendNumeric(ss, datumIndex, alive);
+		appendSerializedDatum(buffer, DataIndex::category, request.protocol);
+		appendSerializedDatum(buffer, DataIndex::alive, request.protocol);
 	}
 	else
 	{
 		for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
 		{
-			if (checkFreshness(datumIndex, time))
-			{
-				switch (datumIndex)
-				{
-				case DataIndex::category:
-					appendString(ss, datumIndex, category);
-					break;
-				case DataIndex::alive:
-					appendNumeric(ss, datumIndex, alive);
-					break;
-				case DataIndex::human:
-					appendNumeric(ss, datumIndex, human);
-					break;
-				case DataIndex::controlled:
-					appendNumeric(ss, datumIndex, controlled);
-					break;
-				case DataIndex::coalition:
-					appendNumeric(ss, datumIndex, coalition);
-					break;
-				case DataIndex::country:
-					appendNumeric(ss, datumIndex, country);
-					break;
-				case DataIndex::name:
-					appendString(ss, datumIndex, name);
-					break;
-				case DataIndex::unitName:
-					appendString(ss, datumIndex, unitName);
-					break;
-				case DataIndex::groupName:
-					appendString(ss, datumIndex, groupName);
-					break;
-				case DataIndex::state:
-					appendNumeric(ss, datumIndex, state);
-					break;
-				case DataIndex::task:
-					appendString(ss, datumIndex, task);
-					break;
-				case DataIndex::hasTask:
-					appendNumeric(ss, datumIndex, hasTask);
-					break;
-				case DataIndex::position:
-					appendNumeric(ss, datumIndex, position);
-					break;
-				case DataIndex::speed:
-					appendNumeric(ss, datumIndex, speed);
-					break;
-				case DataIndex::horizontalVelocity:
-					appendNumeric(ss, datumIndex, horizontalVelocity);
-					break;
-				case DataIndex::verticalVelocity:
-					appendNumeric(ss, datumIndex, verticalVelocity);
-					break;
-				case DataIndex::heading:
-					appendNumeric(ss, datumIndex, heading);
-					break;
-				case DataIndex::track:
-					appendNumeric(ss, datumIndex, track);
-					break;
-				case DataIndex::isActiveTanker:
-					appendNumeric(ss, datumIndex, isActiveTanker);
-					break;
-				case DataIndex::isActiveAWACS:
-					appendNumeric(ss, datumIndex, isActiveAWACS);
-					break;
-				case DataIndex::onOff:
-					appendNumeric(ss, datumIndex, onOff);
-					break;
-				case DataIndex::followRoads:
-					appendNumeric(ss, datumIndex, followRoads);
-					break;
-				case DataIndex::fuel:
-					appendNumeric(ss, datumIndex, fuel);
-					break;
-				case DataIndex::desiredSpeed:
-					appendNumeric(ss, datumIndex, desiredSpeed);
-					break;
-				case DataIndex::desiredSpeedType:
-					appendNumeric(ss, datumIndex, desiredSpeedType);
-					break;
-				case DataIndex::desiredAltitude:
-					appendNumeric(ss, datumIndex, desiredAltitude);
-					break;
-				case DataIndex::desiredAltitudeType:
-					appendNumeric(ss, datumIndex, desiredAltitudeType);
-					break;
-				case DataIndex::leaderID:
-					appendNumeric(ss, datumIndex, leaderID);
-					break;
-				case DataIndex::formationOffset:
-					appendNumeric(ss, datumIndex, formationOffset);
-					break;
-				case DataIndex::targetID:
-					appendNumeric(ss, datumIndex, targetID);
-					break;
-				case DataIndex::targetPosition:
-					appendNumeric(ss, datumIndex, targetPosition);
-					break;
-				case DataIndex::ROE:
-					appendNumeric(ss, datumIndex, ROE);
-					break;
-				case DataIndex::reactionToThreat:
-					appendNumeric(ss, datumIndex, reactionToThreat);
-					break;
-				case DataIndex::emissionsCountermeasures:
-					appendNumeric(ss, datumIndex, emissionsCountermeasures);
-					break;
-				case DataIndex::TACAN:
-					appendNumeric(ss, datumIndex, TACAN);
-					break;
-				case DataIndex::radio:
-					appendNumeric(ss, datumIndex, radio);
-					break;
-				case DataIndex::generalSettings:
-					appendNumeric(ss, datumIndex, generalSettings);
-					break;
-				case DataIndex::ammo:
-					appendVector(ss, datumIndex, ammo);
-					break;
-				case DataIndex::contacts:
-					appendVector(ss, datumIndex, contacts);
-					break;
-				case DataIndex::activePath:
-					appendList(ss, datumIndex, activePath);
-					break;
-				case DataIndex::isLeader:
-					appendNumeric(ss, datumIndex, isLeader);
-					break;
-				case DataIndex::operateAs:
-					appendNumeric(ss, datumIndex, operateAs);
-					break;
-				case DataIndex::shotsScatter:
-					appendNumeric(ss, datumIndex, shotsScatter);
-					break;
-				case DataIndex::shotsIntensity:
-					appendNumeric(ss, datumIndex, shotsIntensity);
-					break;
-				case DataIndex::health:
-					appendNumeric(ss, datumIndex, health);
-					break;
-				}
-			}
+			if (request.isRequested(datumIndex) && checkFreshness(datumIndex, request.time))
+				appendSerializedDatum(buffer, datumIndex, request.protocol);
+		}
+	}
+
+	/* Only masked out data was fresh, skip the unit */
+	if (request.time != 0 && buffer.size() == start + sizeof(ID))
+	{
+		buffer.resize(start);
+		return;
+	}
+	buffer.write(endOfData);
+}
+
+/* Immutable copy of the data of the unit, see DataSnapshot. The last copy is reused until the data or the visibility of the unit changes */
+shared_ptr<const ObjectSnapshot> Unit::getSnapshot()
+{
+	if (snapshot != nullptr && snapshot->lastUpdateVersion == lastUpdateVersion && equal(begin(visibilityVersions), end(visibilityVersions), snapshot->visibilityVersions))
+		return snapshot;
+
+	auto newSnapshot = make_shared<ObjectSnapshot>();
+	newSnapshot->ID = ID;
+	newSnapshot->alive = alive;
+	copy(begin(updateVersions), end(updateVersions), newSnapshot->updateVersions);
+	newSnapshot->lastUpdateVersion = lastUpdateVersion;
+	copy(begin(visibilityVersions), end(visibilityVersions), newSnapshot->visibilityVersions);
+	newSnapshot->setPosition(position, dataVersion.load(), snapshot.get());
+	for (unsigned char protocol = DataProtocol::standard; protocol <= DataProtocol::lastProtocol; protocol++)
+	{
+		for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
+			newSnapshot->blocks[protocol - 1][datumIndex] = getSerializedDatum(datumIndex, protocol);
+	}
+
+	snapshot = newSnapshot;
+	return snapshot;
+}
+
+/* Appends the serialized block of the datum, rebuilding it only if the datum changed since it was last serialized */
+void Unit::appendSerializedDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol)
+{
+	buffer.write(*getSerializedDatum(datumIndex, protocol));
+}
+
+/* A changed datum gets a new block instead of being serialized in place, since the old one may still be referenced by a snapshot */
+const shared_ptr<const string> &Unit::getSerializedDatum(unsigned char datumIndex, unsigned char protocol)
+{
+	shared_ptr<const string> &block = serializedData[protocol - 1][datumIndex];
+	if (block == nullptr)
+	{
+		auto newBlock = make_shared<string>();
+		serializeDatum(*newBlock, datumIndex, protocol);
+		block = std::move(newBlock);
+	}
+	return block;
+}
+
+void Unit::serializeDatum(string &block, unsigned char datumIndex, unsigned char protocol)
+{
+	/* The kinematic data is quantized in the protocol version 2, the rest of the data is the same in all versions */
+	if (protocol == DataProtocol::quantized)
+	{
+		switch (datumIndex)
+		{
+		case DataIndex::position:
+			appendQuantizedCoords(block, datumIndex, position);
+			return;
+		case DataIndex::speed:
+			appendQuantizedSpeed(block, datumIndex, speed);
+			return;
+		case DataIndex::horizontalVelocity:
+			appendQuantizedSpeed(block, datumIndex, horizontalVelocity);
+			return;
+		case DataIndex::verticalVelocity:
+			appendQuantizedSpeed(block, datumIndex, verticalVelocity);
+			return;
+		case DataIndex::heading:
+			appendQuantizedAngle(block, datumIndex, heading);
+			return;
+		case DataIndex::track:
+			appendQuantizedAngle(block, datumIndex, track);
+			return;
 		}
 	}
-	ss.write((const char *)&endOfData, sizeof(endOfData));
+
+	switch (datumIndex)
+	{
+	case DataIndex::category:
+		appendString(block, datumIndex, category);
+		break;
+	case DataIndex::alive:
+		appendNumeric(block, datumIndex, alive);
+		break;
+	case DataIndex::human:
+		appendNumeric(block, datumIndex, human);
+		break;
+	case DataIndex::controlled:
+		appendNumeric(block, datumIndex, controlled);
+		break;
+	case DataIndex::coalition:
+		appendNumeric(block, datumIndex, coalition);
+		break;
+	case DataIndex::country:
+		appendNumeric(block, datumIndex, country);
+		break;
+	case DataIndex::name:
+		appendString(block, datumIndex, name);
+		break;
+	case DataIndex::unitName:
+		appendString(block, datumIndex, unitName);
+		break;
+	case DataIndex::groupName:
+		appendString(block, datumIndex, groupName);
+		break;
+	case DataIndex::state:
+		appendNumeric(block, datumIndex, state);
+		break;
+	case DataIndex::task:
+		appendString(block, datumIndex, task);
+		break;
+	case DataIndex::hasTask:
+		appendNumeric(block, datumIndex, hasTask);
+		break;
+	case DataIndex::position:
+		appendNumeric(block, datumIndex, position);
+		break;
+	case DataIndex::speed:
+		appendNumeric(block, datumIndex, speed);
+		break;
+	case DataIndex::horizontalVelocity:
+		appendNumeric(block, datumIndex, horizontalVelocity);
+		break;
+	case DataIndex::verticalVelocity:
+		appendNumeric(block, datumIndex, verticalVelocity);
+		break;
+	case DataIndex::heading:
+		appendNumeric(block, datumIndex, heading);
+		break;
+	case DataIndex::track:
+		appendNumeric(block, datumIndex, track);
+		break;
+	case DataIndex::isActiveTanker:
+		appendNumeric(block, datumIndex, isActiveTanker);
+		break;
+	case DataIndex::isActiveAWACS:
+		appendNumeric(block, datumIndex, isActiveAWACS);
+		break;
+	case DataIndex::onOff:
+		appendNumeric(block, datumIndex, onOff);
+		break;
+	case DataIndex::followRoads:
+		appendNumeric(block, datumIndex, followRoads);
+		break;
+	case DataIndex::fuel:
+		appendNumeric(block, datumIndex, fuel);
+		break;
+	case DataIndex::desiredSpeed:
+		appendNumeric(block, datumIndex, desiredSpeed);
+		break;
+	case DataIndex::desiredSpeedType:
+		appendNumeric(block, datumIndex, desiredSpeedType);
+		break;
+	case DataIndex::desiredAltitude:
+		appendNumeric(block, datumIndex, desiredAltitude);
+		break;
+	case DataIndex::desiredAltitudeType:
+		appendNumeric(block, datumIndex, desiredAltitudeType);
+		break;
+	case DataIndex::leaderID:
+		appendNumeric(block, datumIndex, leaderID);
+		break;
+	case DataIndex::formationOffset:
+		appendNumeric(block, datumIndex, formationOffset);
+		break;
+	case DataIndex::targetID:
+		appendNumeric(block, datumIndex, targetID);
+		break;
+	case DataIndex::targetPosition:
+		appendNumeric(block, datumIndex, targetPosition);
+		break;
+	case DataIndex::ROE:
+		appendNumeric(block, datumIndex, ROE);
+		break;
+	case DataIndex::reactionToThreat:
+		appendNumeric(block, datumIndex, reactionToThreat);
+		break;
+	case DataIndex::emissionsCountermeasures:
+		appendNumeric(block, datumIndex, emissionsCountermeasures);
+		break;
+	case DataIndex::TACAN:
+		appendNumeric(block, datumIndex, TACAN);
+		break;
+	case DataIndex::radio:
+		appendNumeric(block, datumIndex, radio);
+		break;
+	case DataIndex::generalSettings:
+		appendNumeric(block, datumIndex, generalSettings);
+		break;
+	case DataIndex::ammo:
+		appendVector(block, datumIndex, ammo);
+		break;
+	case DataIndex::contacts:
+		appendVector(block, datumIndex, contacts);
+		break;
+	case DataIndex::activePath:
+		appendList(block, datumIndex, activePath);
+		break;
+	case DataIndex::isLeader:
+		appendNumeric(block, datumIndex, isLeader);
+		break;
+	case DataIndex::operateAs:
+		appendNumeric(block, datumIndex, operateAs);
+		break;
+	case DataIndex::shotsScatter:
+		appendNumeric(block, datumIndex, shotsScatter);
+		break;
+	case DataIndex::shotsIntensity:
+		appendNumeric(block, datumIndex, shotsIntensity);
+		break;
+	case DataIndex::health:
+		appendNumeric(block, datumIndex, health);
+		break;
+	}
+}
+
+void Unit::setAlive(bool newValue)
+{
+	if (alive != newValue)
+	{
+		updateValue(alive, newValue, DataIndex::alive);
+
+		/* The group leader may have changed */
+		unitsManager->onAliveChanged(this);
+	}
+}
+
+void Unit::setCoalition(unsigned char newValue)
+{
+	if (coalition != newValue)
+	{
+		updateValue(coalition, newValue, DataIndex::coalition);
+
+		/* Move the unit to the partition of its new coalition */
+		unitsManager->updateSpatialIndex(this);
+	}
+}
+
+void Unit::setPosition(Coords newValue)
+{
+	if (position != newValue)
+	{
+		updateValue(position, newValue, DataIndex::position);
+
+		/* Move the unit in the spatial index, if it changed cell */
+		unitsManager->updateSpatialIndex(this);
+	}
+}
+
+void Unit::setGroupName(string newValue)
+{
+	if (groupName != newValue)
+	{
+		string oldGroupName = groupName;
+		updateValue(groupName, newValue, DataIndex::groupName);
+
+		/* Move the unit in the group index of the units manager */
+		unitsManager->onGroupNameChanged(this, oldGroupName);
+	}
 }
 
 void Unit::setAmmo(vector<DataTypes::Ammo> newValue)
@@ -728,35 +907,34 @@ void Unit::setTACAN(DataTypes::TACAN newTACAN, bool force)
 		TACAN = newTACAN;
 		if (TACAN.isOn)
 		{
-			std::ostringstream commandSS;
-
 			if (TACAN.channel < 0)
 				TACAN.channel = 0;
 			if (TACAN.channel > 126)
 				TACAN.channel = 126;
 
-			commandSS << "{"
-					  << "id = 'ActivateBeacon',"
-					  << "params = {"
-					  << "type = " << ((TACAN.XY == 'X' == 0) ? 4 : 5) << ","
-					  << "system = 3,"
-					  << "name = \"Olympus_TACAN\","
-					  << "callsign = \"" << TACAN.callsign << "\", "
-					  << "frequency = " << TACANChannelToFrequency(TACAN.channel, TACAN.XY) << ","
-					  << "}"
-					  << "}";
-			Command *command = dynamic_cast<Command *>(new SetCommand(groupName, commandSS.str()));
+			/* The callsign is not null terminated when it is 4 characters long */
+			LuaWriter commandWriter;
+			commandWriter.beginTable()
+				.key("id").value("ActivateBeacon")
+				.key("params").beginTable()
+				.key("type").value((TACAN.XY == 'X' == 0) ? 4 : 5)
+				.key("system").value(3)
+				.key("name").value("Olympus_TACAN")
+				.key("callsign").value(string(TACAN.callsign, strnlen(TACAN.callsign, sizeof(TACAN.callsign))))
+				.key("frequency").value(TACANChannelToFrequency(TACAN.channel, TACAN.XY))
+				.endTable()
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetCommand(groupName, commandWriter.release()));
 			scheduler->appendCommand(command);
 		}
 		else
 		{
-			std::ostringstream commandSS;
-			commandSS << "{"
-					  << "id = 'DeactivateBeacon',"
-					  << "params = {"
-					  << "}"
-					  << "}";
-			Command *command = dynamic_cast<Command *>(new SetCommand(groupName, commandSS.str()));
+			LuaWriter commandWriter;
+			commandWriter.beginTable()
+				.key("id").value("DeactivateBeacon")
+				.key("params").beginTable().endTable()
+				.endTable();
+			Command *command = dynamic_cast<Command *>(new SetCommand(groupName, commandWriter.release()));
 			scheduler->appendCommand(command);
 		}
 
@@ -770,7 +948,7 @@ void Unit::setRadio(DataTypes::Radio newRadio, bool force)
 	{
 		radio = newRadio;
 
-		std::ostringstream commandSS;
+		LuaWriter commandWriter;
 		Command *command;
 
 		if (radio.frequency < 0)
@@ -779,27 +957,24 @@ void Unit::setRadio(DataTypes::Radio newRadio, bool force)
 		if (radio.frequency > 999000000)
 			radio.frequency = 999000000;
 
-		commandSS << "{"
-				  << "id = 'SetFrequency',"
-				  << "params = {"
-				  << "modulation = 0," // TODO Allow selection
-				  << "frequency = " << radio.frequency << ","
-				  << "}"
-				  << "}";
-		command = dynamic_cast<Command *>(new SetCommand(groupName, commandSS.str()));
+		commandWriter.beginTable()
+			.key("id").value("SetFrequency")
+			.key("params").beginTable()
+			.key("modulation").value(0) // TODO Allow selection
+			.key("frequency").value(radio.frequency)
+			.endTable()
+			.endTable();
+		command = dynamic_cast<Command *>(new SetCommand(groupName, commandWriter.release()));
 		scheduler->appendCommand(command);
 
-		// Clear the stringstream
-		commandSS.str(string(""));
-
-		commandSS << "{"
-				  << "id = 'SetCallsign',"
-				  << "params = {"
-				  << "callname = " << to_string(radio.callsign) << ","
-				  << "number = " << to_string(radio.callsignNumber) << ","
-				  << "}"
-				  << "}";
-		command = dynamic_cast<Command *>(new SetCommand(groupName, commandSS.str()));
+		commandWriter.beginTable()
+			.key("id").value("SetCallsign")
+			.key("params").beginTable()
+			.key("callname").value(radio.callsign)
+			.key("number").value(radio.callsignNumber)
+			.endTable()
+			.endTable();
+		command = dynamic_cast<Command *>(new SetCommand(groupName, commandWriter.release()));
 		scheduler->appendCommand(command);
 
 		triggerUpdate(DataIndex::radio);
@@ -904,11 +1079,10 @@ bool Unit::isDestinationReached(double threshold)
 	if (activeDestination != NULL)
 	{
 		/* Check if any unit in the group has reached the point */
+		LocalTangentPlane destinationPlane(activeDestination);
 		for (auto const &p : unitsManager->getGroupMembers(groupName))
 		{
-			double dist = 0;
-			Geodesic::WGS84().Inverse(p->getPosition().lat, p->getPosition().lng, activeDestination.lat, activeDestination.lng, dist);
-			if (dist < threshold)
+			if (destinationPlane.isWithinDistance(p->getPosition(), threshold))
 			{
 				log(unitName + " destination reached");
 				return true;
@@ -994,5 +1168,13 @@ void Unit::setHasTaskAssigned(bool newHasTaskAssigned)
 
 void Unit::triggerUpdate(unsigned char datumIndex)
 {
-	updateTimeMap[datumIndex] = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	if (datumIndex >= DataIndex::lastIndex)
+		return;
+
+	/* Every change gets its own version, so that deltas are exact even for changes happening in the same millisecond */
+	const unsigned long long version = ++dataVersion;
+	updateVersions[datumIndex] = version;
+	lastUpdateVersion = version;
+	for (auto &protocolData : serializedData)
+		protocolData[datumIndex].reset();
 }
@@ -11,6 +11,8 @@
 #include "scheduler.h"
 #include "defines.h"
 
+#include <atomic>
+
 #include <GeographicLib/Geodesic.hpp>
 using namespace GeographicLib;
 
@@ -18,6 +20,7 @@ using namespace GeographicLib;
 using namespace base64;
 
 extern Scheduler *scheduler;
+extern atomic<unsigned long long> dataVersion;
 
 UnitsManager::UnitsManager(lua_State *L)
 {
@@ -47,9 +50,14 @@ bool UnitsManager::isUnitInGroup(Unit *unit)
 		string groupName = unit->getGroupName();
 		if (groupName.length() == 0)
 			return false;
-		for (auto const &p : units)
+
+		auto it = groups.find(groupName);
+		if (it == groups.end())
+			return false;
+
+		for (auto const &member : it->second.members)
 		{
-			if (p.second->getGroupName().compare(groupName) == 0 && p.second != unit && p.second->getAlive())
+			if (member != unit && member->getAlive())
 				return true;
 		}
 	}
@@ -75,25 +83,85 @@ Unit *UnitsManager::getGroupLeader(Unit *unit)
 		string groupName = unit->getGroupName();
 		if (groupName.length() == 0)
 			return nullptr;
-		/* Find the first alive unit that has the same groupName */
-		for (auto const &p : units)
-		{
-			if (p.second->getAlive() && p.second->getGroupName().compare(groupName) == 0)
-				return p.second;
-		}
+
+		/* The leader is the first alive unit that has the same groupName */
+		auto it = groups.find(groupName);
+		if (it != groups.end())
+			return it->second.leader;
 	}
 	return nullptr;
 }
 
 vector<Unit *> UnitsManager::getGroupMembers(string groupName)
 {
-	vector<Unit *> members;
-	for (auto const &p : units)
+	auto it = groups.find(groupName);
+	if (it == groups.end())
+		return vector<Unit *>();
+	return it->second.members;
+}
+
+/* Called by the unit when its group name changes */
+void UnitsManager::onGroupNameChanged(Unit *unit, const string &oldGroupName)
+{
+	removeFromGroup(unit, oldGroupName);
+	addToGroup(unit);
+}
+
+/* Called by the unit when it is killed or revived, since the leader of its group may change and only alive units are spatially indexed */
+void UnitsManager::onAliveChanged(Unit *unit)
+{
+	auto it = groups.find(unit->getGroupName());
+	if (it != groups.end())
+		updateGroupLeader(it->second);
+
+	spatialIndex.update(unit);
+}
+
+/* Called by the unit when its position or coalition changes */
+void UnitsManager::updateSpatialIndex(Unit *unit)
+{
+	spatialIndex.update(unit);
+}
+
+void UnitsManager::addToGroup(Unit *unit)
+{
+	GroupIndexEntry &group = groups[unit->getGroupName()];
+
+	/* Keep the members sorted by ID */
+	auto position = lower_bound(group.members.begin(), group.members.end(), unit, [](Unit *a, Unit *b) { return a->getID() < b->getID(); });
+	if (position != group.members.end() && *position == unit)
+		return;
+	group.members.insert(position, unit);
+
+	updateGroupLeader(group);
+}
+
+void UnitsManager::removeFromGroup(Unit *unit, const string &groupName)
+{
+	auto it = groups.find(groupName);
+	if (it == groups.end())
+		return;
+
+	GroupIndexEntry &group = it->second;
+	group.members.erase(remove(group.members.begin(), group.members.end(), unit), group.members.end());
+
+	if (group.members.empty())
+		groups.erase(it);
+	else
+		updateGroupLeader(group);
+}
+
+void UnitsManager::updateGroupLeader(GroupIndexEntry &group)
+{
+	group.leader = nullptr;
+	for (auto const &member : group.members)
 	{
-		if (p.second->getGroupName().compare(groupName) == 0)
-			members.push_back(p.second);
+		if (member->getAlive())
+		{
+			group.leader = member;
+			break;
+		}
 	}
-	return members;
 }
 
 Unit *UnitsManager::getGroupLeader(unsigned int ID)
@@ -102,6 +170,20 @@ Unit *UnitsManager::getGroupLeader(unsigned int ID)
 	return getGroupLeader(unit);
 }
 
+Unit *UnitsManager::createUnit(string category, json json, unsigned int ID)
+{
+	if (category.compare("Aircraft") == 0)
+		return dynamic_cast<Unit *>(new Aircraft(json, ID));
+	else if (category.compare("Helicopter") == 0)
+		return dynamic_cast<Unit *>(new Helicopter(json, ID));
+	else if (category.compare("GroundUnit") == 0)
+		return dynamic_cast<Unit *>(new GroundUnit(json, ID));
+	else if (category.compare("NavyUnit") == 0)
+		return dynamic_cast<Unit *>(new NavyUnit(json, ID));
+	else
+		return nullptr;
+}
+
 void UnitsManager::update(json &data, double dt)
 {
 	for (json::iterator it = data.begin(); it != data.end(); ++it)
@@ -114,18 +196,14 @@ void UnitsManager::update(json &data, double dt)
 			if (json_has_string_field(value, "category"))
 			{
 				string category = value["category"].template get<string>();
-				if (category.compare("Aircraft") == 0)
-					units[ID] = dynamic_cast<Unit *>(new Aircraft(it.value(), ID));
-				else if (category.compare("Helicopter") == 0)
-					units[ID] = dynamic_cast<Unit *>(new Helicopter(it.value(), ID));
-				else if (category.compare("GroundUnit") == 0)
-					units[ID] = dynamic_cast<Unit *>(new GroundUnit(it.value(), ID));
-				else if (category.compare("NavyUnit") == 0)
-					units[ID] = dynamic_cast<Unit *>(new NavyUnit(it.value(), ID));
+				Unit *unit = createUnit(category, it.value(), ID);
 
 				/* Initialize the unit if creation was successfull */
-				if (units.count(ID) != 0)
+				if (unit != nullptr)
 				{
+					units[ID] = unit;
+					addToGroup(unit);
+					spatialIndex.update(unit);
 					units[ID]->update(it.value(), dt);
 					units[ID]->initialize(it.value());
 				}
@@ -138,6 +216,43 @@ void UnitsManager::update(json &data, double dt)
 				units[ID]->update(it.value(), dt);
 		}
 	}
+
+	updateVisibility();
+}
+
+/* Applies the frames captured by the ingest pipeline. Runs on the ingest worker thread, under the global lock */
+void UnitsManager::update(const FrameBuffer<UnitFrame> &buffer)
+{
+	for (size_t i = 0; i < buffer.size; i++)
+	{
+		const UnitFrame &frame = buffer.frames[i];
+		auto it = units.find(frame.ID);
+		if (it == units.end())
+		{
+			/* Frames which are not full only flag that a unit no longer exists, so they can not create a new one */
+			if (frame.full)
+			{
+				Unit *unit = createUnit(frame.category, json::object(), frame.ID);
+
+				/* Initialize the unit if creation was successfull */
+				if (unit != nullptr)
+				{
+					units[frame.ID] = unit;
+					addToGroup(unit);
+					spatialIndex.update(unit);
+					unit->update(frame, buffer.dt);
+					unit->initialize(frame);
+				}
+			}
+		}
+		else
+		{
+			/* Update the unit if present*/
+			it->second->update(frame, buffer.dt);
+		}
+	}
+
+	updateVisibility();
 }
 
 void UnitsManager::runAILoop()
@@ -147,102 +262,100 @@ void UnitsManager::runAILoop()
 		unit.second->runAILoop();
 }
 
-void UnitsManager::getUnitData(stringstream &ss, unsigned long long time)
+void UnitsManager::getUnitData(ByteBuffer &buffer, const DataRequest &request)
 {
 	for (auto const &p : units)
-		p.second->getData(ss, time);
+		appendUnitData(buffer, p.second, request);
 }
 
-void UnitsManager::deleteUnit(unsigned int ID, bool explosion, string explosionType, bool immediate)
+/* Appends the data of the unit as seen by the coalition of the request. Units which became visible since the reference time get all their data, since
+	the client may not know them, and the ones which were hidden get a removal notice */
+void UnitsManager::appendUnitData(ByteBuffer &buffer, Unit *unit, const DataRequest &request)
 {
-	if (getUnit(ID) != nullptr)
+	if (request.coalition < 0)
 	{
-		Command *command = dynamic_cast<Command *>(new Delete(ID, explosion, explosionType, immediate));
-		scheduler->appendCommand(command);
+		unit->getData(buffer, request);
+		return;
 	}
+
+	const bool visibilityChanged = request.time != 0 && unit->getVisibilityVersion(request.coalition) > request.time;
+	if (isVisible(unit->getID(), request.coalition))
+	{
+		if (visibilityChanged)
+		{
+			DataRequest fullRequest = request;
+			fullRequest.time = 0;
+			unit->getData(buffer, fullRequest);
+		}
+		else
+			unit->getData(buffer, request);
+	}
+	else if (visibilityChanged)
+		DataSnapshot::appendRemovalNotice(buffer, unit->getID());
 }
 
-Unit *UnitsManager::getClosestUnit(Unit *unit, unsigned char coalition, vector<string> categories, double &distance)
+/* Builds, for the red and blue coalitions, the set of the units they can see: their own units, and the contacts of their alive units. It runs once per
+	data tick, so that serializing the data of a commander only has to test a bit. The units whose visibility changed get a new data version */
+void UnitsManager::updateVisibility()
 {
-	Unit *closestUnit = nullptr;
-	distance = 0;
+	const unsigned int maxID = units.empty() ? 0 : units.rbegin()->first;
+
+	vector<bool> newVisibility[3];
+	for (unsigned char coalition = 1; coalition < 3; coalition++)
+		newVisibility[coalition].assign(maxID + 1, false);
 
 	for (auto const &p : units)
 	{
-		/* Check if the units category is of the correct type */
-		bool requestedCategory = false;
-		for (auto const &category : categories)
+		Unit *unit = p.second;
+		const unsigned char coalition = unit->getCoalition();
+		if (coalition == 0 || coalition >= 3)
+			continue;
+
+		newVisibility[coalition][p.first] = true;
+		if (unit->getAlive())
 		{
-			if (p.second->getCategory().compare(category) == 0)
-			{
-				requestedCategory = true;
-				break;
-			}
+			for (auto const &contact : unit->getContacts())
+				if (contact.ID <= maxID)
+					newVisibility[coalition][contact.ID] = true;
 		}
+	}
 
-		/* Check if the unit belongs to the desired coalition, is alive, and is of the category requested */
-		if (requestedCategory && p.second->getCoalition() == coalition && p.second->getAlive())
+	for (unsigned char coalition = 1; coalition < 3; coalition++)
+	{
+		for (auto const &p : units)
 		{
-			/* Compute the distance from the unit to the tested unit */
-			double dist;
-			double bearing1;
-			double bearing2;
-			Geodesic::WGS84().Inverse(unit->getPosition().lat, unit->getPosition().lng, p.second->getPosition().lat, p.second->getPosition().lng, dist, bearing1, bearing2);
-			double altDelta = unit->getPosition().alt - p.second->getPosition().alt;
-
-			/* If the closest unit has not been assigned yet, assign it to this unit */
-			if (closestUnit == nullptr)
-			{
-				closestUnit = p.second;
-				distance = sqrt(dist * dist + altDelta * altDelta);
-			}
-			else
-			{
-				/* Check if the unit is closer than the one already selected */
-				if (dist < distance)
-				{
-					closestUnit = p.second;
-					distance = sqrt(dist * dist + altDelta * altDelta);
-				}
-			}
+			const bool wasVisible = p.first < visibility[coalition].size() && visibility[coalition][p.first];
+			if (wasVisible != newVisibility[coalition][p.first])
+				p.second->setVisibilityVersion(coalition, ++dataVersion);
 		}
+		visibility[coalition].swap(newVisibility[coalition]);
 	}
-
-	return closestUnit;
 }
 
-map<Unit *, double> UnitsManager::getUnitsInRange(Unit *unit, unsigned char coalition, vector<string> categories, double range)
+bool UnitsManager::isVisible(unsigned int ID, unsigned char coalition)
 {
-	map<Unit *, double> unitsInRange;
+	if (coalition == 0 || coalition >= 3)
+		return true;
+	return ID < visibility[coalition].size() && visibility[coalition][ID];
+}
 
-	for (auto const &p : units)
+void UnitsManager::deleteUnit(unsigned int ID, bool explosion, string explosionType, bool immediate)
+{
+	if (getUnit(ID) != nullptr)
 	{
-		/* Check if the units category is of the correct type */
-		bool requestedCategory = false;
-		for (auto const &category : categories)
-		{
-			if (p.second->getCategory().compare(category) == 0)
-			{
-				requestedCategory = true;
-				break;
-			}
-		}
-
-		/* Check if the unit belongs to the desired coalition, is alive, and is of the category requested */
-		if (requestedCategory && p.second->getCoalition() == coalition && p.second->getAlive())
-		{
-			/* Compute the distance from the unit to the tested unit */
-			double dist;
-			double bearing1;
-			double bearing2;
-			Geodesic::WGS84().Inverse(unit->getPosition().lat, unit->getPosition().lng, p.second->getPosition().lat, p.second->getPosition().lng, dist, bearing1, bearing2);
-
-			if (dist <= range)
-				unitsInRange[p.second] = dist;
-		}
+		Command *command = dynamic_cast<Command *>(new Delete(ID, explosion, explosionType, immediate));
+		scheduler->appendCommand(command);
 	}
+}
 
-	return unitsInRange;
+Unit *UnitsManager::getClosestUnit(Unit *unit, unsigned char coalition, vector<string> categories, double &distance)
+{
+	return spatialIndex.getClosestUnit(unit, coalition, categories, distance);
+}
+
+map<Unit *, double> UnitsManager::getUnitsInRange(Unit *unit, unsigned char coalition, vector<string> categories, double range)
+{
+	return spatialIndex.getUnitsInRange(unit, coalition, categories, range);
 }
 
 void UnitsManager::acquireControl(unsigned int ID)
@@ -6,8 +6,11 @@
 #include "defines.h"
 
 #include <chrono>
+#include <atomic>
 using namespace std::chrono;
 
+extern atomic<unsigned long long> dataVersion;
+
 Weapon::Weapon(json json, unsigned int ID) : ID(ID)
 {
 	log("Creating weapon with ID: " + to_string(ID));
@@ -47,73 +50,152 @@ void Weapon::update(json json, double dt)
 		setAlive(json["isAlive"].template get<bool>());
 }
 
+/* Counterpart of initialize(json) for the frames captured by the ingest pipeline */
+void Weapon::initialize(const WeaponFrame &frame)
+{
+	setName(frame.name);
+	setCoalition(frame.coalition);
+
+	update(frame, 0);
+}
+
+/* Counterpart of update(json, dt) for the frames captured by the ingest pipeline. Runs on the ingest worker thread, under the global lock */
+void Weapon::update(const WeaponFrame &frame, double dt)
+{
+	if (!frame.full)
+	{
+		/* The weapon no longer exists */
+		setAlive(false);
+		return;
+	}
+
+	setPosition(frame.position);
+	setHeading(frame.heading);
+	setSpeed(frame.speed);
+	setAlive(frame.alive);
+}
+
 bool Weapon::checkFreshness(unsigned char datumIndex, unsigned long long time)
 {
-	auto it = updateTimeMap.find(datumIndex);
-	if (it == updateTimeMap.end())
-		return false;
-	else
-		return it->second > time;
+	return datumIndex < DataIndex::lastIndex && updateVersions[datumIndex] > time;
 }
 
 bool Weapon::hasFreshData(unsigned long long time)
 {
-	for (auto it : updateTimeMap)
-		if (it.second > time)
-			return true;
-	return false;
+	return lastUpdateVersion > time;
 }
 
-void Weapon::getData(stringstream &ss, unsigned long long time)
+void Weapon::getData(ByteBuffer &buffer, const DataRequest &request)
 {
+	/* Weapons with nothing new are skipped entirely */
+	if (request.time != 0 && !hasFreshData(request.time))
+		return;
+
 	const unsigned char endOfData = DataIndex::endOfData;
-	ss.write((const char *)&ID, sizeof(ID));
-	if (!alive && time == 0)
+	const size_t start = buffer.size();
+	buffer.write(ID);
+	if (!alive && request.time == 0)
 	{
-		unsigned char datumIndex = DataIndex::category;
-		appendString(ss, datumIndex, category);
-		datumIndex = DataIndex::alive;
-		appendNumeric(ss, datumIndex, alive);
+		serializeDatum(buffer, DataIndex::category, request.protocol);
+		serializeDatum(buffer, DataIndex::alive, request.protocol);
 	}
 	else
 	{
 		for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
 		{
-			if (checkFreshness(datumIndex, time))
+			if (request.isRequested(datumIndex) && checkFreshness(datumIndex, request.time))
+				serializeDatum(buffer, datumIndex, request.protocol);
+		}
+	}
+
+	/* Only masked out data was fresh, skip the weapon */
+	if (request.time != 0 && buffer.size() == start + sizeof(ID))
+	{
+		buffer.resize(start);
+		return;
+	}
+	buffer.write(endOfData);
+}
+
+void Weapon::serializeDatum(ByteBuffer &buffer, unsigned char datumIndex, unsigned char protocol)
+{
+	switch (datumIndex)
+	{
+	case DataIndex::category:
+		appendString(buffer, datumIndex, category);
+		break;
+	case DataIndex::alive:
+		appendNumeric(buffer, datumIndex, alive);
+		break;
+	case DataIndex::coalition:
+		appendNumeric(buffer, datumIndex, coalition);
+		break;
+	case DataIndex::name:
+		appendString(buffer, datumIndex, name);
+		break;
+	case DataIndex::position:
+		if (protocol == DataProtocol::quantized)
+			appendNumeric(buffer, datumIndex, quantizeCoords(position));
+		else
+			appendNumeric(buffer, datumIndex, position);
+		break;
+	case DataIndex::speed:
+		if (protocol == DataProtocol::quantized)
+			appendNumeric(buffer, datumIndex, quantizeSpeed(speed));
+		else
+			appendNumeric(buffer, datumIndex, speed);
+		break;
+	case DataIndex::heading:
+		if (protocol == DataProtocol::quantized)
+			appendNumeric(buffer, datumIndex, quantizeAngle(heading));
+		else
+			appendNumeric(buffer, datumIndex, heading);
+		break;
+	}
+}
+
+/* Immutable copy of the data of the weapon, see DataSnapshot. The last copy is reused until the weapon changes, and only the blocks of the data which
+	changed since are serialized again */
+shared_ptr<const ObjectSnapshot> Weapon::getSnapshot()
+{
+	if (snapshot != nullptr && snapshot->lastUpdateVersion == lastUpdateVersion)
+		return snapshot;
+
+	auto newSnapshot = make_shared<ObjectSnapshot>();
+	newSnapshot->ID = ID;
+	newSnapshot->alive = alive;
+	copy(begin(updateVersions), end(updateVersions), newSnapshot->updateVersions);
+	newSnapshot->lastUpdateVersion = lastUpdateVersion;
+
+	ByteBuffer block;
+	for (unsigned char protocol = DataProtocol::standard; protocol <= DataProtocol::lastProtocol; protocol++)
+	{
+		for (unsigned char datumIndex = DataIndex::startOfData + 1; datumIndex < DataIndex::lastIndex; datumIndex++)
+		{
+			if (snapshot != nullptr && updateVersions[datumIndex] <= snapshot->lastUpdateVersion)
+				newSnapshot->blocks[protocol - 1][datumIndex] = snapshot->blocks[protocol - 1][datumIndex];
+			else
 			{
-				switch (datumIndex)
-				{
-				case DataIndex::category:
-					appendString(ss, datumIndex, category);
-					break;
-				case DataIndex::alive:
-					appendNumeric(ss, datumIndex, alive);
-					break;
-				case DataIndex::coalition:
-					appendNumeric(ss, datumIndex, coalition);
-					break;
-				case DataIndex::name:
-					appendString(ss, datumIndex, name);
-					break;
-				case DataIndex::position:
-					appendNumeric(ss, datumIndex, position);
-					break;
-				case DataIndex::speed:
-					appendNumeric(ss, datumIndex, speed);
-					break;
-				case DataIndex::heading:
-					appendNumeric(ss, datumIndex, heading);
-					break;
-				}
+				block.clear();
+				serializeDatum(block, datumIndex, protocol);
+				newSnapshot->blocks[protocol - 1][datumIndex] = make_shared<const string>(block.release());
 			}
 		}
 	}
-	ss.write((const char *)&endOfData, sizeof(endOfData));
+
+	snapshot = newSnapshot;
+	return snapshot;
 }
 
 void Weapon::triggerUpdate(unsigned char datumIndex)
 {
-	updateTimeMap[datumIndex] = duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+	if (datumIndex >= DataIndex::lastIndex)
+		return;
+
+	/* Every change gets its own version, so that deltas are exact even for changes happening in the same millisecond */
+	const unsigned long long version = ++dataVersion;
+	updateVersions[datumIndex] = version;
+	lastUpdateVersion = version;
 }
 
 /* Missile */
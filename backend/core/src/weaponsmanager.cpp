@@ -62,8 +62,43 @@ void WeaponsManager::update(json &data, double dt)
 	}
 }
 
-void WeaponsManager::getWeaponData(stringstream &ss, unsigned long long time)
+/* Applies the frames captured by the ingest pipeline. Runs on the ingest worker thread, under the global lock */
+void WeaponsManager::update(const FrameBuffer<WeaponFrame> &buffer)
+{
+	for (size_t i = 0; i < buffer.size; i++)
+	{
+		const WeaponFrame &frame = buffer.frames[i];
+		auto it = weapons.find(frame.ID);
+		if (it == weapons.end())
+		{
+			/* Frames which are not full only flag that a weapon no longer exists, so they can not create a new one */
+			if (frame.full)
+			{
+				Weapon *weapon = nullptr;
+				if (frame.category.compare("Missile") == 0)
+					weapon = dynamic_cast<Weapon *>(new Missile(json::object(), frame.ID));
+				else if (frame.category.compare("Bomb") == 0)
+					weapon = dynamic_cast<Weapon *>(new Bomb(json::object(), frame.ID));
+
+				/* Initialize the weapon if creation was successfull */
+				if (weapon != nullptr)
+				{
+					weapons[frame.ID] = weapon;
+					weapon->update(frame, buffer.dt);
+					weapon->initialize(frame);
+				}
+			}
+		}
+		else
+		{
+			/* Update the weapon if present*/
+			it->second->update(frame, buffer.dt);
+		}
+	}
+}
+
+void WeaponsManager::getWeaponData(ByteBuffer &buffer, const DataRequest &request)
 {
 	for (auto const &p : weapons)
-		p.second->getData(ss, time);
+		p.second->getData(buffer, request);
 }
@@ -104,6 +104,24 @@ int dostring_in(lua_State *L, string target, string command)
     return lua_pcall(L, 2, 0, 0);
 }
 
+/* Same as above, result holds the value returned by the command as converted to a string by DCS, empty if it returned nothing */
+int dostring_in(lua_State *L, string target, string command, string &result)
+{
+    STACK_INIT;
+
+    lua_getglobal(L, "net");
+    lua_getfield(L, -1, "dostring_in");
+    lua_pushstring(L, target.c_str());
+    lua_pushstring(L, command.c_str());
+    int error = lua_pcall(L, 2, 1, 0);
+
+    const char *value = error == 0 ? lua_tostring(L, -1) : nullptr;
+    result = value != nullptr ? value : "";
+
+    STACK_CLEAN;
+    return error;
+}
+
 unsigned int TACANChannelToFrequency(unsigned int channel, char XY)
 {
     unsigned int basef = (XY == 'X' && channel > 63) || (XY == 'Y' && channel < 64) ? 1087 : 961;
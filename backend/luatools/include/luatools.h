@@ -6,6 +6,13 @@ void DllExport stackPop(lua_State *L, int popDepth = 1);
 void DllExport stackClean(lua_State *L, int stackDepth);
 void DllExport luaTableToJSON(lua_State *L, int index, json &json, bool logKeys = false);
 void DllExport luaLogTableKeys(lua_State *L, int index);
+int DllExport luaAbsIndex(lua_State *L, int index);
+bool DllExport luaGetNumberField(lua_State *L, int index, const char *field, double &value);
+bool DllExport luaGetBooleanField(lua_State *L, int index, const char *field, bool &value);
+bool DllExport luaGetStringField(lua_State *L, int index, const char *field, string &value);
+bool DllExport luaGetNumberAt(lua_State *L, int index, int position, double &value);
+bool DllExport luaGetBooleanAt(lua_State *L, int index, int position, bool &value);
+bool DllExport luaGetStringAt(lua_State *L, int index, int position, const char *&value, size_t &length);
 
 #define STACK_UPDATE stackUpdate(L, stackDepth, initialStack);
 #define STACK_INIT        \
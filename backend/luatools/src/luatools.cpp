@@ -80,3 +80,79 @@ void luaTableToJSON(lua_State *L, int index, json &data, bool logKeys)
         STACK_CLEAN;
     }
 }
+
+
+/* Converts a relative stack index into an absolute one, so that it stays valid when values are pushed on the stack (Lua 5.1 has no lua_absindex) */
+int luaAbsIndex(lua_State *L, int index)
+{
+    if (index < 0 && index > LUA_REGISTRYINDEX)
+        return lua_gettop(L) + index + 1;
+    return index;
+}
+
+/* Typed field getters. They read a single field of the table at index directly from the Lua stack, without going through json.
+    The value is only written if the field exists and has the requested type. The stack is left unchanged. */
+bool luaGetNumberField(lua_State *L, int index, const char *field, double &value)
+{
+    lua_getfield(L, index, field);
+    bool found = lua_type(L, -1) == LUA_TNUMBER;
+    if (found)
+        value = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+    return found;
+}
+
+bool luaGetBooleanField(lua_State *L, int index, const char *field, bool &value)
+{
+    lua_getfield(L, index, field);
+    bool found = lua_isboolean(L, -1);
+    if (found)
+        value = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return found;
+}
+
+bool luaGetStringField(lua_State *L, int index, const char *field, string &value)
+{
+    lua_getfield(L, index, field);
+    bool found = lua_type(L, -1) == LUA_TSTRING;
+    if (found)
+    {
+        size_t length = 0;
+        const char *str = lua_tolstring(L, -1, &length);
+        value.assign(str, length);
+    }
+    lua_pop(L, 1);
+    return found;
+}
+/* Positional getters, used to read flat (array-like) tables. The table at index must be an absolute index. The returned string
+    points to the Lua owned string, and is only valid as long as the table at index holds a reference to it. */
+bool luaGetNumberAt(lua_State *L, int index, int position, double &value)
+{
+    lua_rawgeti(L, index, position);
+    bool found = lua_type(L, -1) == LUA_TNUMBER;
+    if (found)
+        value = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+    return found;
+}
+
+bool luaGetBooleanAt(lua_State *L, int index, int position, bool &value)
+{
+    lua_rawgeti(L, index, position);
+    bool found = lua_isboolean(L, -1);
+    if (found)
+        value = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+    return found;
+}
+
+bool luaGetStringAt(lua_State *L, int index, int position, const char *&value, size_t &length)
+{
+    lua_rawgeti(L, index, position);
+    bool found = lua_type(L, -1) == LUA_TSTRING;
+    if (found)
+        value = lua_tolstring(L, -1, &length);
+    lua_pop(L, 1);
+    return found;
+}
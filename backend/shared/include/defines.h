@@ -5,6 +5,42 @@
 
 #define FRAMERATE_TIME_INTERVAL 0.05
 
+/* Set to true to decode the units and weapons data through the legacy Lua table -> json conversion, on the simulation thread, instead of the ingest pipeline */
+#define DATA_JSON_DECODER false
+
+/* Maximum number of units and weapons data ticks waiting for the ingest worker. Older ticks are merged into the following ones by the worker */
+#define INGEST_MAX_PENDING_BUFFERS 4
+
+/* Interval, in microseconds, at which the ingest worker retries the global lock while it is held elsewhere. The ticks captured meanwhile are merged */
+#define INGEST_LOCK_RETRY_INTERVAL 1000
+
+/* Compression of the units and weapons responses. Smaller responses are sent uncompressed */
+#define COMPRESSION_MIN_SIZE 1024
+#define COMPRESSION_DEFLATE_LEVEL 6
+#define COMPRESSION_ZSTD_LEVEL 3
+#define COMPRESSION_CACHE_SIZE 32
+
+/* Lifetime, in seconds, of the tokens used to open the data stream */
+#define STREAM_TOKEN_LIFETIME 30
+
+/* Time budget, in microseconds, for handling the queued client requests in each simulation frame. The remaining requests are handled in the next frames */
+#define SCHEDULER_REQUESTS_BUDGET 2000
+
+/* Time budget, in microseconds, for executing the queued commands in each simulation frame. The cost of the commands is estimated from the measured cost
+	of their type, see CommandCost. The time spent over the budget is paid back in the next frames */
+#define SCHEDULER_EXECUTION_BUDGET 3000
+#define SCHEDULER_INITIAL_LOAD_COST 200		/* Cost of a load unit, in microseconds, for the command types which were never measured (see Command::getLoad) */
+#define SCHEDULER_COST_SAMPLES 128			/* Number of samples used for the 95th percentile of the cost of a command type */
+
+/* Set to true to send each batch of commands as a single table to Olympus.dispatch, instead of one Olympus.protectedCall statement per command. Either way
+	the batch is compiled as one chunk, so a command which does not compile fails the whole batch, which is then run again one command at a time (see
+	Scheduler::execute). Olympus.dispatch stops at a command raising an error and reports it, the commands after it are sent again. Without it the runtime
+	errors are only contained to their command, and not reported */
+#define SCHEDULER_DISPATCH_BATCH true
+
+/* Number of executed or failed commands whose hash is remembered. Older commands are reported as unknown */
+#define SCHEDULER_EXECUTED_HISTORY_SIZE 4096
+
 #define OLYMPUS_JSON_PATH "..\\..\\..\\..\\Config\\olympus.json"
 #define AIRCRAFT_DATABASE_PATH "..\\client\\public\\databases\\units\\aircraftdatabase.json"
 #define HELICOPTER_DATABASE_PATH "..\\client\\public\\databases\\units\\helicopterdatabase.json"
@@ -0,0 +1,27 @@
+#pragma once
+#include "framework.h"
+#include "logger.h"
+
+/* Checks for the standalone tests. A failed check is reported with its location and the test carries on, the runner fails if any check failed */
+extern int testFailures;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << endl; \
+			testFailures++; \
+		} \
+	} while (false)
+
+lua_State *newTestState();
+
+void runQuantizationTests();
+void runDataSnapshotTests();
+void runDataAreaTests();
+void runUnitsDataTests();
+void runGroupsTests();
+void runSpatialQueryTests();
+void runCompressionTests();
+void runLuaCommandsTests();
+void runCommandQueueTests();
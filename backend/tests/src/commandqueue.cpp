@@ -0,0 +1,310 @@
+#include "tests.h"
+#include "scheduler.h"
+#include "scriptloader.h"
+#include "dcstools.h"
+
+#include <chrono>
+using namespace std::chrono;
+
+/* Command queues of the Scheduler (see Scheduler::appendCommand and Scheduler::execute). Identical commands are discarded and a newer command of the same
+	group replaces the queued one, the load counter must always match the commands left in the queues, and the commands must run highest priority first,
+	in the order they were queued. Queueing queueSizes commands, half of them duplicates, must cost the same per command whatever the queue size, as a scan
+	of the queue for each new command would not. The commands run in a stand-in of the DCS server state, which records the calls it receives.
+	Each frame runs the commands which fit in SCHEDULER_EXECUTION_BUDGET, consecutive commands of the same type as one chunk sent to Olympus.dispatch, and
+	the time spent over the budget delays the next frames. A command raising an error stops the dispatch, the commands after it run in a new chunk, and
+	the commands of a chunk which does not compile run one at a time: either way each command runs once. Running dispatchedCount commands as one dispatched chunk must be cheaper than compiling and
+	running a chunk for each command, as before the dispatcher */
+static const unsigned int queueSizes[] = { 1000, 10000 };
+static const double scalingFactor = 5;		/* Bound of the per command time ratio, a scan of the queue would give queueSizes[1] / queueSizes[0] */
+static const unsigned int batchSize = 50;
+static const unsigned int dispatchedCount = 1000;
+
+/* Stand-in for net.dostring_in and the Olympus functions of OlympusCommand.lua. Olympus.dispatch is the one of OlympusCommand.lua */
+static const char *serverScript = R"(
+	chunksCount = 0
+	calls = {}
+	net = {
+		dostring_in = function(target, code)
+			chunksCount = chunksCount + 1
+			local result = assert(loadstring(code))()
+			if result ~= nil then
+				return tostring(result)
+			end
+		end
+	}
+
+	function Olympus.dispatch(batch)
+		for index, command in ipairs(batch) do
+			if not Olympus.protectedCall(unpack(command, 1, table.maxn(command))) then
+				return index
+			end
+		end
+		return 0
+	end
+
+	function Olympus.move(groupName, lat, lng)
+		calls[#calls + 1] = "move " .. groupName .. " " .. lat
+	end
+
+	function Olympus.smoke(color, lat, lng)
+		if color == "slow" then
+			local start = os.clock()
+			while os.clock() - start < 0.01 do end
+		end
+		if color == "error" then
+			error("Smoke failed")
+		end
+		calls[#calls + 1] = "smoke " .. color
+	end
+)";
+
+static lua_State *newServerState()
+{
+	lua_State *L = newTestState();
+	luaL_dostring(L, "trigger = { action = { outText = function() end } }");
+	CHECK(luaL_dostring(L, PROTECTED_CALL) == 0);
+	CHECK(luaL_dostring(L, serverScript) == 0);
+	return L;
+}
+
+/* Calls received by the stand-in since the last time, in order */
+static vector<string> takeCalls(lua_State *L)
+{
+	vector<string> calls;
+	lua_getglobal(L, "calls");
+	const size_t count = lua_objlen(L, -1);
+	for (size_t i = 1; i <= count; i++)
+	{
+		lua_rawgeti(L, -1, static_cast<int>(i));
+		calls.push_back(lua_tostring(L, -1));
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+	luaL_dostring(L, "calls = {}");
+	return calls;
+}
+
+static int getChunksCount(lua_State *L)
+{
+	lua_getglobal(L, "chunksCount");
+	const int count = static_cast<int>(lua_tointeger(L, -1));
+	lua_pop(L, 1);
+	luaL_dostring(L, "chunksCount = 0");
+	return count;
+}
+
+/* Runs the scheduler until its queues are empty, the budget may need several frames */
+static void drain(lua_State *L, Scheduler &scheduler)
+{
+	for (unsigned int frame = 0; frame < 100000 && scheduler.getLoad() > 0; frame++)
+		scheduler.execute(L);
+}
+
+static void testQueues(lua_State *L)
+{
+	Scheduler scheduler(L);
+	unsigned int callbacks = 0;
+
+	/* Identical commands are discarded, the hash of the queued one is returned */
+	Smoke *red = new Smoke("red", Coords{ 42, 42, 0 });
+	const string redHash = red->getHash();
+	CHECK(scheduler.appendCommand(red));
+	string queuedHash;
+	CHECK(!scheduler.appendCommand(new Smoke("red", Coords{ 42, 42, 0 }), &queuedHash));
+	CHECK(queuedHash == redHash);
+	CHECK(scheduler.appendCommand(new Smoke("blue", Coords{ 42, 42, 0 })));
+	CHECK(scheduler.getLoad() == 4);
+
+	/* A newer move of the same group replaces the queued one, and runs its callback */
+	Move *first = new Move("Group 1", Coords{ 43, 41, 0 }, 200, "GS", 1000, "ASL", "nil", "Aircraft", false, [&callbacks]() { callbacks++; });
+	const string firstHash = first->getHash();
+	CHECK(scheduler.appendCommand(first));
+	Move *second = new Move("Group 1", Coords{ 44, 41, 0 }, 200, "GS", 1000, "ASL", "nil", "Aircraft", false, [&callbacks]() { callbacks++; });
+	const string secondHash = second->getHash();
+	CHECK(scheduler.appendCommand(second));
+	CHECK(scheduler.getCommandStatus(firstHash) == CommandStatus::SUPERSEDED);
+	CHECK(scheduler.getCommandStatus(secondHash) == CommandStatus::PENDING);
+	CHECK(scheduler.getLoad() == 4 + 5);
+
+	/* The move has a higher priority than the smokes */
+	drain(L, scheduler);
+	CHECK(takeCalls(L) == vector<string>({ "move Group 1 44", "smoke red", "smoke blue" }));
+	CHECK(callbacks == 2);
+	CHECK(scheduler.getLoad() == 0);
+	CHECK(scheduler.getCommandStatus(secondHash) == CommandStatus::EXECUTED);
+	CHECK(scheduler.getCommandStatus(redHash) == CommandStatus::EXECUTED);
+}
+
+static void testBatches(lua_State *L)
+{
+	Scheduler scheduler(L);
+	takeCalls(L);
+	getChunksCount(L);
+
+	/* The cost of a command type which never ran is estimated from its load, the first frame runs as many as fit in the budget */
+	for (unsigned int i = 0; i < batchSize; i++)
+		scheduler.appendCommand(new Smoke("color " + to_string(i), Coords{ 42, 42, 0 }));
+	scheduler.execute(L);
+	const unsigned int estimatedCount = SCHEDULER_EXECUTION_BUDGET / (2 * SCHEDULER_INITIAL_LOAD_COST);
+	CHECK(takeCalls(L).size() == estimatedCount);
+	CHECK(getChunksCount(L) == 1);
+	CHECK(scheduler.getLoad() == static_cast<int>(2 * (batchSize - estimatedCount)));
+
+	/* Once measured, all the remaining ones fit in the next frame, in one chunk */
+	scheduler.execute(L);
+	CHECK(takeCalls(L).size() == batchSize - estimatedCount);
+	CHECK(getChunksCount(L) == 1);
+	CHECK(scheduler.getLoad() == 0);
+
+	/* Consecutive commands of the same type share a chunk. The moves have a higher priority, the first frame runs the few of them which fit in the budget
+		while their cost is estimated from their load, the second one the other moves then the smokes */
+	for (unsigned int i = 0; i < batchSize; i++)
+	{
+		scheduler.appendCommand(new Move("Group " + to_string(i), Coords{ 42, 42, 0 }, 200, "GS", 1000, "ASL", "nil", "Aircraft", false));
+		scheduler.appendCommand(new Smoke("color " + to_string(i), Coords{ 42, 42, 0 }));
+	}
+	drain(L, scheduler);
+	CHECK(takeCalls(L).size() == 2 * batchSize);
+	CHECK(getChunksCount(L) == 3);
+
+	/* The time spent over the budget delays the next frames */
+	scheduler.appendCommand(new Smoke("slow", Coords{ 42, 42, 0 }));
+	scheduler.execute(L);
+	CHECK(takeCalls(L).size() == 1);
+	CHECK(scheduler.getCostStatistics()["executionDebt"].get<double>() > 0);
+	scheduler.appendCommand(new Smoke("fast", Coords{ 42, 42, 0 }));
+	scheduler.execute(L);
+	CHECK(takeCalls(L).empty());
+	drain(L, scheduler);
+	CHECK(takeCalls(L) == vector<string>({ "smoke fast" }));
+}
+
+static void testFailedCommands(lua_State *L)
+{
+	Scheduler scheduler(L);
+	takeCalls(L);
+
+	/* Runtime error, the commands before and after it run once */
+	vector<string> hashes;
+	for (const char *color : { "first", "error", "second", "error", "third" })
+	{
+		Smoke *smoke = new Smoke(color, Coords{ 42.0 + hashes.size(), 42, 0 });
+		hashes.push_back(smoke->getHash());
+		scheduler.appendCommand(smoke);
+	}
+	drain(L, scheduler);
+	CHECK(takeCalls(L) == vector<string>({ "smoke first", "smoke second", "smoke third" }));
+	CHECK(scheduler.getCommandStatus(hashes[0]) == CommandStatus::EXECUTED);
+	CHECK(scheduler.getCommandStatus(hashes[1]) == CommandStatus::FAILED);
+	CHECK(scheduler.getCommandStatus(hashes[2]) == CommandStatus::EXECUTED);
+	CHECK(scheduler.getCommandStatus(hashes[3]) == CommandStatus::FAILED);
+	CHECK(scheduler.getCommandStatus(hashes[4]) == CommandStatus::EXECUTED);
+
+	/* A command which does not compile fails the chunk before any command runs, the others run on their own */
+	hashes.clear();
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		Move *move = new Move("Group " + to_string(i), Coords{ 42, 42, 0 }, 200, "GS", 1000, "ASL", i == 1 ? "{" : "nil", "Aircraft", false);
+		hashes.push_back(move->getHash());
+		scheduler.appendCommand(move);
+	}
+	drain(L, scheduler);
+	CHECK(takeCalls(L) == vector<string>({ "move Group 0 42", "move Group 2 42" }));
+	CHECK(scheduler.getCommandStatus(hashes[0]) == CommandStatus::EXECUTED);
+	CHECK(scheduler.getCommandStatus(hashes[1]) == CommandStatus::FAILED);
+	CHECK(scheduler.getCommandStatus(hashes[2]) == CommandStatus::EXECUTED);
+}
+
+/* Runs the same commands dispatched in one chunk, then with one chunk for each command */
+static void testDispatchCost(lua_State *L)
+{
+	vector<string> commandStrings;
+	for (unsigned int i = 0; i < dispatchedCount; i++)
+	{
+		Move move("Group " + to_string(i), Coords{ 42 + i * 1e-3, 41, 0 }, 200, "GS", 1000, "ASL", "nil", "Aircraft", false);
+		commandStrings.push_back(move.getString());
+	}
+	takeCalls(L);
+
+	auto start = steady_clock::now();
+	string entries;
+	for (auto const &commandString : commandStrings)
+		entries += "{" + commandString + "},\n";
+	CHECK(dostring_in(L, "server", "Olympus.dispatch({\n" + entries + "})") == 0);
+	const double dispatchTime = duration<double, micro>(steady_clock::now() - start).count();
+	const vector<string> dispatchedCalls = takeCalls(L);
+
+	start = steady_clock::now();
+	for (auto const &commandString : commandStrings)
+		CHECK(dostring_in(L, "server", "Olympus.protectedCall(" + commandString + ")") == 0);
+	const double chunksTime = duration<double, micro>(steady_clock::now() - start).count();
+
+	CHECK(dispatchedCalls.size() == dispatchedCount);
+	CHECK(takeCalls(L) == dispatchedCalls);
+	cout << "Execution of " << dispatchedCount << " commands, in microseconds: " << dispatchTime << " dispatched in one chunk, " << chunksTime <<
+		" with a chunk each" << endl;
+	CHECK(dispatchTime < chunksTime);
+}
+
+/* Returns the time to queue the commands, in microseconds */
+static double queueCommands(lua_State *L, unsigned int queueSize)
+{
+	Scheduler scheduler(L);
+
+	vector<Command *> commands;
+	for (unsigned int i = 0; i < queueSize; i++)
+	{
+		commands.push_back(new Smoke("color " + to_string(i), Coords{ 42, 42, 0 }));
+		commands.push_back(new Smoke("color " + to_string(i), Coords{ 42, 42, 0 }));
+	}
+
+	unsigned int queued = 0;
+	int load = 0;
+	const auto start = steady_clock::now();
+	for (auto command : commands)
+	{
+		if (scheduler.appendCommand(command))
+			queued++;
+		load = scheduler.getLoad();
+	}
+	const double queueTime = duration<double, micro>(steady_clock::now() - start).count();
+	CHECK(queued == queueSize);
+	CHECK(load == static_cast<int>(2 * queueSize));
+
+	/* The commands run in the order they were queued */
+	drain(L, scheduler);
+	const vector<string> calls = takeCalls(L);
+	CHECK(calls.size() == queueSize);
+	unsigned int outOfOrder = 0;
+	for (unsigned int i = 0; i < calls.size(); i++)
+	{
+		if (calls[i] != "smoke color " + to_string(i))
+			outOfOrder++;
+	}
+	CHECK(outOfOrder == 0);
+	CHECK(scheduler.getLoad() == 0);
+
+	return queueTime;
+}
+
+void runCommandQueueTests()
+{
+	lua_State *L = newServerState();
+
+	testQueues(L);
+	testBatches(L);
+	testFailedCommands(L);
+	testDispatchCost(L);
+
+	vector<double> commandTimes;
+	for (unsigned int queueSize : queueSizes)
+	{
+		const double queueTime = queueCommands(L, queueSize);
+		commandTimes.push_back(queueTime / queueSize);
+		cout << "Queueing of " << queueSize << " commands and as many duplicates: " << queueTime << " microseconds, " << queueTime / queueSize <<
+			" per command" << endl;
+	}
+	CHECK(commandTimes.back() <= commandTimes.front() * scalingFactor);
+
+	lua_close(L);
+}
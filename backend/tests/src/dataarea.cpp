@@ -0,0 +1,116 @@
+#include "tests.h"
+#include "datasnapshot.h"
+
+#include <map>
+
+/* Area requests served from a snapshot (see DataSnapshot::appendAreaUnitData). Two units, one in each of two distant boxes, do not move. A client which
+	fetched the first box and then pans to the second one must get the unit of the second box in full and a removal notice for the unit of the first */
+enum AreaRecord { fullRecord, partialRecord, removalRecord };
+
+static shared_ptr<const ObjectSnapshot> makeAreaUnit(unsigned int ID, Coords position)
+{
+	auto unit = make_shared<ObjectSnapshot>();
+	unit->ID = ID;
+	unit->alive = true;
+	unit->updateVersions[DataIndex::category] = 1;
+	unit->updateVersions[DataIndex::alive] = 1;
+	unit->updateVersions[DataIndex::position] = 1;
+	unit->lastUpdateVersion = 1;
+
+	string category;
+	category.push_back(static_cast<char>(DataIndex::category));
+	const unsigned short size = 0;
+	category.append(reinterpret_cast<const char *>(&size), sizeof(size));
+	unit->blocks[DataProtocol::standard - 1][DataIndex::category] = make_shared<const string>(category);
+
+	string alive;
+	alive.push_back(static_cast<char>(DataIndex::alive));
+	alive.push_back(1);
+	unit->blocks[DataProtocol::standard - 1][DataIndex::alive] = make_shared<const string>(alive);
+
+	unit->setPosition(position, 1, nullptr);
+	return unit;
+}
+
+/* Records of the units in the data, by ID. Only the category and alive blocks of the test units and the removal notices are expected */
+static map<unsigned int, AreaRecord> getAreaRecords(const DataSnapshot &snapshot, const DataRequest &request)
+{
+	ByteBuffer buffer;
+	snapshot.getUnitData(buffer, request);
+	const string data = buffer.release();
+
+	map<unsigned int, AreaRecord> records;
+	size_t offset = 0;
+	while (offset + sizeof(unsigned int) < data.size())
+	{
+		unsigned int ID = 0;
+		memcpy(&ID, data.data() + offset, sizeof(ID));
+		offset += sizeof(ID);
+
+		AreaRecord record = partialRecord;
+		while (offset < data.size())
+		{
+			const unsigned char datumIndex = static_cast<unsigned char>(data[offset++]);
+			if (datumIndex == DataIndex::endOfData)
+				break;
+			else if (datumIndex == DataIndex::category)
+			{
+				record = fullRecord;
+				offset += sizeof(unsigned short);
+			}
+			else if (datumIndex == DataIndex::alive)
+				offset += 1;
+			else if (datumIndex == DataIndex::removed)
+				record = removalRecord;
+		}
+		records[ID] = record;
+	}
+	return records;
+}
+
+void runDataAreaTests()
+{
+	DataSnapshot snapshot;
+	snapshot.version = 2;
+	snapshot.units.push_back(makeAreaUnit(1, Coords{ 42, 42, 0 }));
+	snapshot.units.push_back(makeAreaUnit(2, Coords{ 43, 45, 0 }));
+
+	DataArea firstBox;
+	firstBox.setBox(41.5, 41.5, 42.5, 42.5);
+	DataArea secondBox;
+	secondBox.setBox(42.5, 44.5, 43.5, 45.5);
+
+	/* Full fetch of the first box */
+	DataRequest request;
+	request.area = firstBox;
+	auto records = getAreaRecords(snapshot, request);
+	CHECK(records.size() == 1 && records.count(1) == 1 && records[1] == fullRecord);
+
+	/* Delta of the same box, nothing changed */
+	request.time = 1;
+	request.referenceArea = firstBox;
+	CHECK(getAreaRecords(snapshot, request).empty());
+
+	/* Pan to the second box */
+	request.area = secondBox;
+	records = getAreaRecords(snapshot, request);
+	CHECK(records.size() == 2);
+	CHECK(records.count(1) == 1 && records[1] == removalRecord);
+	CHECK(records.count(2) == 1 && records[2] == fullRecord);
+
+	/* Delta without the reference area, the client may know any unit */
+	request.referenceArea = DataArea();
+	records = getAreaRecords(snapshot, request);
+	CHECK(records.size() == 2);
+	CHECK(records.count(1) == 1 && records[1] == removalRecord);
+	CHECK(records.count(2) == 1 && records[2] == fullRecord);
+
+	/* Zoom out to a box holding both units, only the unit which was not in the first box is new */
+	DataArea wideBox;
+	wideBox.setBox(41, 41, 44, 46);
+	request.area = wideBox;
+	request.referenceArea = firstBox;
+	records = getAreaRecords(snapshot, request);
+	CHECK(records.count(2) == 1 && records[2] == fullRecord);
+	CHECK(records.count(1) == 0 || records[1] != removalRecord);
+}
@@ -0,0 +1,148 @@
+#include "tests.h"
+#include "unitsmanager.h"
+#include "weaponsmanager.h"
+#include "unit.h"
+#include "ingest.h"
+#include "datasnapshot.h"
+
+#include <chrono>
+using namespace std::chrono;
+
+extern UnitsManager *unitsManager;
+extern WeaponsManager *weaponsManager;
+
+/* Group index of the UnitsManager (see UnitsManager::addToGroup). Units in groups of four die, revive and change group from tick to tick. After each
+	tick the leaders, members and group flags given by the index must match a scan of all the units, which is what the manager did before the index.
+	The cost of a data tick (applying the frames, which runs the AI loop and the leader lookup of every unit, then publishing the snapshot) is measured
+	at several unit counts, and must grow linearly: the per unit cost at the largest count is bounded by a multiple of the one at the smallest count */
+static const unsigned int unitsCounts[] = { 500, 2000, 5000 };
+static const unsigned int ticksCount = 8;
+static const unsigned int groupSize = 4;
+static const double scalingFactor = 5;		/* Bound of the per unit tick time ratio, a quadratic pass would give unitsCounts[2] / unitsCounts[0] */
+
+static string getGroupName(unsigned int ID, unsigned int tick)
+{
+	/* Every 7th unit moves to the next group on odd ticks */
+	unsigned int group = (ID - 1) / groupSize;
+	if (ID % 7 == 0 && tick % 2 == 1)
+		group++;
+	return "Group " + to_string(group);
+}
+
+static void fillFrames(FrameBuffer<UnitFrame> &buffer, unsigned int unitsCount, unsigned int tick)
+{
+	const char *categories[] = { "Aircraft", "Helicopter", "GroundUnit", "NavyUnit" };
+
+	buffer.clear();
+	buffer.dt = 0.2;
+	for (unsigned int ID = 1; ID <= unitsCount; ID++)
+	{
+		UnitFrame &frame = buffer.next();
+		frame.ID = ID;
+		frame.full = true;
+		frame.category = categories[(ID / groupSize) % 4];
+		frame.name = "F-16C_50";
+		frame.coalition = static_cast<unsigned char>(ID % 2 + 1);
+		frame.position = Coords{ 42 + (ID % 100) * 0.01 + tick * 1e-4, 41 + (ID / 100) * 0.01, 1000 };
+		frame.heading = 1;
+		frame.track = 1;
+		frame.speed = 200;
+
+		/* The leaders die on some ticks, so that the leadership moves to the next member and back */
+		frame.alive = !(ID % groupSize == 1 && (ID / groupSize + tick) % 3 == 0) && ID % 11 != tick % 11;
+
+		frame.hasControllerData = true;
+		frame.unitName = "Unit " + to_string(ID);
+		frame.groupName = getGroupName(ID, tick);
+		frame.fuel = 0.5;
+		frame.health = 100;
+	}
+}
+
+/* Returns the number of units for which the index differs from a scan of all the units */
+static unsigned int checkGroups(UnitsManager *manager)
+{
+	unsigned int mismatches = 0;
+	auto &units = manager->getUnits();
+
+	map<string, vector<Unit *>> groups;
+	for (auto const &p : units)
+		groups[p.second->getGroupName()].push_back(p.second);
+
+	for (auto const &p : units)
+	{
+		Unit *unit = p.second;
+		const vector<Unit *> &members = groups[unit->getGroupName()];
+
+		Unit *expectedLeader = nullptr;
+		bool expectedInGroup = false;
+		for (auto const &member : members)
+		{
+			if (member->getAlive() && expectedLeader == nullptr)
+				expectedLeader = member;
+			if (member != unit && member->getAlive())
+				expectedInGroup = true;
+		}
+
+		Unit *leader = nullptr;
+		const bool isLeader = manager->isUnitGroupLeader(unit, leader);
+		if (manager->getGroupLeader(unit) != expectedLeader || isLeader != (expectedLeader == unit) || manager->isUnitInGroup(unit) != expectedInGroup ||
+			manager->getGroupMembers(unit->getGroupName()) != members)
+			mismatches++;
+	}
+	return mismatches;
+}
+
+/* Returns the median time of a data tick, in microseconds */
+static double runTicks(lua_State *L, unsigned int unitsCount)
+{
+	UnitsManager *manager = new UnitsManager(L);
+	unitsManager = manager;
+
+	FrameBuffer<UnitFrame> buffer;
+	fillFrames(buffer, unitsCount, 0);
+	manager->update(buffer);
+	CHECK(manager->getUnits().size() == unitsCount);
+	CHECK(checkGroups(manager) == 0);
+
+	vector<double> tickTimes;
+	for (unsigned int tick = 1; tick <= ticksCount; tick++)
+	{
+		fillFrames(buffer, unitsCount, tick);
+
+		const auto start = steady_clock::now();
+		manager->update(buffer);
+		DataSnapshot::publish();
+		tickTimes.push_back(duration<double, micro>(steady_clock::now() - start).count());
+
+		CHECK(checkGroups(manager) == 0);
+		CHECK(DataSnapshot::getLatest()->units.size() == unitsCount);
+	}
+
+	for (auto const &p : manager->getUnits())
+		delete p.second;
+	delete manager;
+	unitsManager = nullptr;
+
+	nth_element(tickTimes.begin(), tickTimes.begin() + tickTimes.size() / 2, tickTimes.end());
+	return tickTimes[tickTimes.size() / 2];
+}
+
+void runGroupsTests()
+{
+	lua_State *L = newTestState();
+	weaponsManager = new WeaponsManager(L);
+
+	vector<double> unitTimes;
+	for (unsigned int unitsCount : unitsCounts)
+	{
+		const double tickTime = runTicks(L, unitsCount);
+		unitTimes.push_back(tickTime / unitsCount);
+		cout << "Data tick with " << unitsCount << " units: " << tickTime << " microseconds, " << tickTime / unitsCount << " per unit" << endl;
+	}
+	CHECK(unitTimes.back() <= unitTimes.front() * scalingFactor);
+
+	delete weaponsManager;
+	weaponsManager = nullptr;
+	lua_close(L);
+}
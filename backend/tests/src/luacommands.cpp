@@ -0,0 +1,260 @@
+#include "tests.h"
+#include "commands.h"
+#include "luawriter.h"
+
+#include <cmath>
+#include <cfloat>
+#include <random>
+#include <chrono>
+using namespace std::chrono;
+
+/* Lua source of the commands (see LuaWriter). Strings and numbers written by the writer are read back by the Lua 5.1 parser of a test state: strings must
+	come back byte for byte whatever they contain, and numbers must come back as the same double. The commands must carry their arguments in the order
+	Olympus.dispatch calls them with, and generating commandsCount of them must be cheaper than with the ostringstream builders they replaced */
+static const unsigned int commandsCount = 100000;
+static const unsigned int randomNumbersCount = 10000;
+
+/* Evaluates a Lua expression, its value is left on the stack */
+static bool evaluate(lua_State *L, const string &expression)
+{
+	return luaL_dostring(L, ("return " + expression).c_str()) == 0 && lua_gettop(L) > 0;
+}
+
+static bool isSameString(lua_State *L, const string &text)
+{
+	LuaWriter writer;
+	writer.value(text);
+	if (!evaluate(L, writer.str()))
+		return false;
+
+	size_t length = 0;
+	const char *value = lua_tolstring(L, -1, &length);
+	const bool same = value != nullptr && string(value, length) == text;
+	lua_settop(L, 0);
+	return same;
+}
+
+static bool isSameNumber(lua_State *L, double number)
+{
+	LuaWriter writer;
+	writer.value(number);
+	if (!evaluate(L, writer.str()))
+		return false;
+
+	const bool same = lua_isnumber(L, -1) && lua_tonumber(L, -1) == number;
+	lua_settop(L, 0);
+	return same;
+}
+
+static void testStrings(lua_State *L)
+{
+	CHECK(isSameString(L, ""));
+	CHECK(isSameString(L, "Group 1"));
+	CHECK(isSameString(L, "Quote \" and backslash \\ in a name"));
+	CHECK(isSameString(L, "New\nline\r\ttab"));
+	CHECK(isSameString(L, "\x01" "9 control character before a digit"));
+	CHECK(isSameString(L, string("Embedded\0zero", 13)));
+	CHECK(isSameString(L, "Caf\xc3\xa9 \xd0\x9c\xd0\x98\xd0\x93-29"));
+
+	/* A name must not be able to break out of its string */
+	CHECK(isSameString(L, "\"); os.exit(1) --"));
+	CHECK(isSameString(L, "\\\"); os.exit(1) --"));
+	CHECK(isSameString(L, "]] .. os.exit(1) .. [["));
+
+	string allBytes;
+	for (unsigned int character = 0; character < 256; character++)
+		allBytes.push_back(static_cast<char>(character));
+	CHECK(isSameString(L, allBytes));
+}
+
+static void testNumbers(lua_State *L)
+{
+	const double samples[] = { 0, 1, -1, 0.1, 1.0 / 3, 42.123456789012345, -179.99999999999997, 1e21, 1e-7, 123456789012345678.0, DBL_MAX, DBL_MIN,
+		-DBL_MAX, 4.9406564584124654e-324 };
+	for (double number : samples)
+		CHECK(isSameNumber(L, number));
+
+	/* Random doubles of any magnitude */
+	mt19937_64 generator(42);
+	unsigned int mismatches = 0;
+	for (unsigned int i = 0; i < randomNumbersCount; i++)
+	{
+		const unsigned long long bits = generator();
+		double number = 0;
+		memcpy(&number, &bits, sizeof(number));
+		if (isfinite(number) && !isSameNumber(L, number))
+			mismatches++;
+	}
+	CHECK(mismatches == 0);
+
+	/* The shortest form is written */
+	CHECK(LuaWriter().value(0.1).str() == "0.1");
+	CHECK(LuaWriter().value(42.5).str() == "42.5");
+	CHECK(LuaWriter().value(1e21).str() == "1e+21");
+	CHECK(LuaWriter().value(-3).str() == "-3");
+	CHECK(LuaWriter().value(4000000000u).str() == "4000000000");
+
+	/* Lua has no literals for NaN and infinity */
+	CHECK(evaluate(L, LuaWriter().value(NAN).str()) && isnan(lua_tonumber(L, -1)));
+	lua_settop(L, 0);
+	CHECK(evaluate(L, LuaWriter().value(-INFINITY).str()) && isinf(lua_tonumber(L, -1)) && lua_tonumber(L, -1) < 0);
+	lua_settop(L, 0);
+}
+
+static void testTables()
+{
+	LuaWriter writer;
+	writer.code("Olympus.setTask").value("Group \"1\"").beginTable()
+		.key("id").value("Orbit")
+		.key("params").beginTable().key("altitude").value(7620.5).key("pattern").value("Circle").endTable()
+		.endTable()
+		.beginTable().value(true).value(false).beginTable().endTable().endTable();
+	CHECK(writer.str() == "Olympus.setTask, \"Group \\\"1\\\"\", {id = \"Orbit\", params = {altitude = 7620.5, pattern = \"Circle\"}}, {true, false, {}}");
+
+	const string expected = writer.str();
+	CHECK(writer.release() == expected && writer.size() == 0);
+	writer.value(1);
+	CHECK(writer.str() == "1");
+}
+
+static void testCommands(lua_State *L)
+{
+	CHECK(luaL_dostring(L, "Olympus = { move = function() end, spawnUnits = function() end }") == 0);
+
+	const Coords destination{ 42.123456789012345, 41.98765432109876, 0 };
+	Move move("Group \"A\"", destination, 123.456789, "GS", 7620.5, "ASL", "{id = \"FollowRoads\"}", "Aircraft", false);
+	CHECK(evaluate(L, "{" + move.getString() + "}"));
+	lua_setglobal(L, "command");
+	CHECK(luaL_dostring(L, R"(
+		assert(command[1] == Olympus.move and command[2] == 'Group "A"' and command[5] == 7620.5 and command[6] == "ASL" and command[7] == 123.456789)
+		assert(command[8] == "GS" and command[9] == "Aircraft" and command[10].id == "FollowRoads")
+	)") == 0);
+	lua_getglobal(L, "command");
+	lua_rawgeti(L, -1, 3);
+	lua_rawgeti(L, -2, 4);
+	CHECK(lua_tonumber(L, -2) == destination.lat && lua_tonumber(L, -1) == destination.lng);
+	lua_settop(L, 0);
+
+	const vector<SpawnOptions> spawnOptions = {
+		SpawnOptions{ "T-72B", Coords{ 43.000000000000014, 44.5, 0 }, "", "Excellent", "desert" },
+		SpawnOptions{ "M-1 Abrams", Coords{ 43.1, 44.6, 0 }, "", "High", "It's \"green\"\n" }
+	};
+	SpawnGroundUnits spawn("blue", spawnOptions, "USA", false);
+	CHECK(evaluate(L, "{" + spawn.getString() + "}"));
+	lua_setglobal(L, "command");
+	CHECK(luaL_dostring(L, R"(
+		local options = command[2]
+		assert(command[1] == Olympus.spawnUnits and options.category == "GroundUnit" and options.coalition == "blue" and options.country == "USA")
+		assert(#options.units == 2 and options.units[1].unitType == "T-72B" and options.units[1].skill == "Excellent")
+		assert(options.units[1].lat == 43.000000000000014 and options.units[2].liveryID == 'It\'s "green"\n')
+	)") == 0);
+	lua_settop(L, 0);
+}
+
+/* The builders of the Move and SpawnGroundUnits commands before the LuaWriter */
+static string getLegacyMoveString(const string &groupName, const Coords &destination, double speed, const string &speedType, double altitude,
+	const string &altitudeType, const string &taskOptions, const string &category)
+{
+	std::ostringstream commandSS;
+	commandSS.precision(10);
+	commandSS << "Olympus.move, "
+		<< "\"" << groupName << "\"" << ", "
+		<< destination.lat << ", "
+		<< destination.lng << ", "
+		<< altitude << ", "
+		<< "\"" << altitudeType << "\"" << ", "
+		<< speed << ", "
+		<< "\"" << speedType << "\"" << ", "
+		<< "\"" << category << "\"" << ", "
+		<< taskOptions;
+	return commandSS.str();
+}
+
+static string getLegacySpawnString(const string &coalition, const vector<SpawnOptions> &spawnOptions, const string &country)
+{
+	std::ostringstream unitsSS;
+	unitsSS.precision(10);
+	for (int i = 0; i < spawnOptions.size(); i++) {
+		unitsSS << "[" << i + 1 << "] = {"
+			<< "unitType = " << "\"" << spawnOptions[i].unitType << "\"" << ", "
+			<< "lat = " << spawnOptions[i].location.lat << ", "
+			<< "lng = " << spawnOptions[i].location.lng << ", "
+			<< "liveryID = " << "\"" << spawnOptions[i].liveryID << "\"" << ", "
+			<< "skill =  \"" << spawnOptions[i].skill << "\"" << "}, ";
+	}
+
+	std::ostringstream commandSS;
+	commandSS.precision(10);
+	commandSS << "Olympus.spawnUnits, {"
+		<< "category = " << "\"" << "GroundUnit" << "\"" << ", "
+		<< "coalition = " << "\"" << coalition << "\"" << ", "
+		<< "country = \"" << country << "\", "
+		<< "units = " << "{" << unitsSS.str() << "}" << "}";
+	return commandSS.str();
+}
+
+/* Half moves and half spawns of two units, as the scheduler generates them when the commands are queued */
+static void testGenerationCost()
+{
+	mt19937 generator(42);
+	uniform_real_distribution<double> unit(0, 1);
+
+	double writerTime = 0;
+	double legacyTime = 0;
+	size_t writerSize = 0;
+	size_t legacySize = 0;
+	for (unsigned int i = 0; i < commandsCount; i++)
+	{
+		const string groupName = "Group " + to_string(i);
+		const Coords destination{ 40 + 5 * unit(generator), 36 + 11 * unit(generator), 0 };
+		const double speed = 300 * unit(generator);
+		const double altitude = 10000 * unit(generator);
+
+		if (i % 2 == 0)
+		{
+			Move move(groupName, destination, speed, "GS", altitude, "ASL", "{}", "Aircraft", false);
+
+			auto start = steady_clock::now();
+			writerSize += move.getString().size();
+			writerTime += duration<double, micro>(steady_clock::now() - start).count();
+
+			start = steady_clock::now();
+			legacySize += getLegacyMoveString(groupName, destination, speed, "GS", altitude, "ASL", "{}", "Aircraft").size();
+			legacyTime += duration<double, micro>(steady_clock::now() - start).count();
+		}
+		else
+		{
+			const vector<SpawnOptions> spawnOptions = {
+				SpawnOptions{ "T-72B", destination, "", "Excellent", "desert" },
+				SpawnOptions{ "T-72B", Coords{ destination.lat + 1e-3, destination.lng, 0 }, "", "Excellent", "desert" }
+			};
+			SpawnGroundUnits spawn("red", spawnOptions, "RUSSIA", false);
+
+			auto start = steady_clock::now();
+			writerSize += spawn.getString().size();
+			writerTime += duration<double, micro>(steady_clock::now() - start).count();
+
+			start = steady_clock::now();
+			legacySize += getLegacySpawnString("red", spawnOptions, "RUSSIA").size();
+			legacyTime += duration<double, micro>(steady_clock::now() - start).count();
+		}
+	}
+
+	CHECK(writerSize > 0 && legacySize > 0);
+	cout << "Generation of " << commandsCount << " commands, in milliseconds: " << writerTime / 1000 << " with the LuaWriter, " << legacyTime / 1000 <<
+		" with ostringstream" << endl;
+	CHECK(writerTime < legacyTime);
+}
+
+void runLuaCommandsTests()
+{
+	lua_State *L = newTestState();
+
+	testStrings(L);
+	testNumbers(L);
+	testTables();
+	testCommands(L);
+	testGenerationCost();
+
+	lua_close(L);
+}
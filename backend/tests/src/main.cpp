@@ -0,0 +1,46 @@
+#include "tests.h"
+#include "unitsmanager.h"
+#include "weaponsmanager.h"
+#include "scheduler.h"
+
+#include <atomic>
+
+int testFailures = 0;
+
+/* Singleton objects of core.cpp, used by the core sources linked in the tests */
+UnitsManager *unitsManager = nullptr;
+WeaponsManager *weaponsManager = nullptr;
+Scheduler *scheduler = nullptr;
+atomic<unsigned long long> dataVersion = 0;
+string instancePath;
+
+/* Lua state with the parts of the DCS scripting environment used by the core sources, the log functions */
+lua_State *newTestState()
+{
+	lua_State *L = luaL_newstate();
+	luaL_openlibs(L);
+	luaL_dostring(L, "log = { INFO = 1, WARNING = 2, ERROR = 3, write = function() end }");
+	return L;
+}
+
+/* Runs all the tests, the exit code is the number of failed checks */
+int main()
+{
+	setLogDirectory(filesystem::temp_directory_path().string());
+
+	runQuantizationTests();
+	runDataSnapshotTests();
+	runDataAreaTests();
+	runUnitsDataTests();
+	runGroupsTests();
+	runSpatialQueryTests();
+	runCompressionTests();
+	runLuaCommandsTests();
+	runCommandQueueTests();
+
+	if (testFailures == 0)
+		cout << "All tests passed" << endl;
+	else
+		cout << testFailures << " checks failed" << endl;
+	return testFailures;
+}
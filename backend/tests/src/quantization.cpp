@@ -0,0 +1,147 @@
+#include "tests.h"
+#include "datatypes.h"
+
+#include <cmath>
+
+/* Round trip of the protocol version 2 quantization (see quantizeCoords, quantizeSpeed and quantizeAngle in datatypes.h). The values are serialized
+	as the units do (see appendQuantizedCoords and Unit::serializeDatum), then decoded from the bytes as the client does in extractPosition, extractSpeed
+	and extractAngle (see dataextractor.ts): a datum index, then little endian integers of 4 bytes for each coordinate, 2 bytes for a speed and an angle.
+	The error must stay within the documented bounds */
+static const double twoPi = 6.283185307179586;
+static const double degreesBound = 5e-8;
+static const double altitudeBound = 0.005;
+static const double speedBound = 0.05;
+static const double angleBound = twoPi / 65536 / 2;
+static const double speedLimit = 3276.7;
+static const unsigned char testIndex = DataIndex::position;
+
+/* Margin for the rounding of the double arithmetic itself */
+static bool withinBound(double error, double bound)
+{
+	return fabs(error) <= bound * (1 + 1e-9) + 1e-12;
+}
+
+/* Little endian unsigned integer of the given size, as read by a DataView */
+static unsigned int readLittleEndian(const string &block, size_t offset, size_t size)
+{
+	unsigned int value = 0;
+	for (size_t i = 0; i < size; i++)
+		value |= static_cast<unsigned int>(static_cast<unsigned char>(block[offset + i])) << (8 * i);
+	return value;
+}
+
+static int readInt32(const string &block, size_t offset)
+{
+	return static_cast<int>(readLittleEndian(block, offset, 4));
+}
+
+static Coords decodeCoords(const string &block)
+{
+	CHECK(block.size() == 13 && static_cast<unsigned char>(block[0]) == testIndex);
+	if (block.size() != 13)
+		return Coords();
+	return Coords{ readInt32(block, 1) / 1e7, readInt32(block, 5) / 1e7, readInt32(block, 9) / 100.0 };
+}
+
+static double decodeSpeed(const string &block)
+{
+	CHECK(block.size() == 3 && static_cast<unsigned char>(block[0]) == testIndex);
+	if (block.size() != 3)
+		return 0;
+	return static_cast<short>(readLittleEndian(block, 1, 2)) / 10.0;
+}
+
+static double decodeAngle(const string &block)
+{
+	CHECK(block.size() == 3 && static_cast<unsigned char>(block[0]) == testIndex);
+	if (block.size() != 3)
+		return 0;
+	return readLittleEndian(block, 1, 2) / 65536.0 * twoPi;
+}
+
+static Coords roundTripCoords(const Coords &coords)
+{
+	string block;
+	appendQuantizedCoords(block, testIndex, coords);
+	return decodeCoords(block);
+}
+
+static double roundTripSpeed(double speed)
+{
+	string block;
+	appendQuantizedSpeed(block, testIndex, speed);
+	return decodeSpeed(block);
+}
+
+static double roundTripAngle(double angle)
+{
+	string block;
+	appendQuantizedAngle(block, testIndex, angle);
+	return decodeAngle(block);
+}
+
+/* Difference between two angles, in [-pi, pi) */
+static double angleDifference(double a, double b)
+{
+	double difference = fmod(a - b, twoPi);
+	if (difference >= twoPi / 2)
+		difference -= twoPi;
+	else if (difference < -twoPi / 2)
+		difference += twoPi;
+	return difference;
+}
+
+static void testCoords()
+{
+	const double latitudes[] = { -90, -89.99999995, -45.123456789, 0, 1e-8, 41.987654321, 89.99999996, 90 };
+	const double longitudes[] = { -180, -179.99999994, -12.3456789012, 0, 3.00000005, 123.456789012, 179.99999997, 180 };
+	const double altitudes[] = { -500.004, 0, 0.005, 1234.5678, 15000.001, 20000000 };
+
+	for (double lat : latitudes)
+	{
+		for (double lng : longitudes)
+		{
+			for (double alt : altitudes)
+			{
+				const Coords coords{ lat, lng, alt };
+				const Coords decoded = roundTripCoords(coords);
+				CHECK(withinBound(decoded.lat - lat, degreesBound));
+				CHECK(withinBound(decoded.lng - lng, degreesBound));
+				CHECK(withinBound(decoded.alt - alt, altitudeBound));
+			}
+		}
+	}
+}
+
+static void testSpeed()
+{
+	const double speeds[] = { -speedLimit, -1000.04, -0.05, 0, 0.04, 0.06, 340.29, 1000.55, speedLimit };
+	for (double speed : speeds)
+		CHECK(withinBound(roundTripSpeed(speed) - speed, speedBound));
+
+	/* Speeds out of range are clamped to the limits */
+	CHECK(roundTripSpeed(speedLimit + 1000) == speedLimit);
+	CHECK(roundTripSpeed(-speedLimit - 1000) == -speedLimit);
+}
+
+static void testAngle()
+{
+	const double angles[] = { -4 * twoPi - 1, -twoPi, -1e-9, 0, 1e-9, 1, twoPi / 2, twoPi - 1e-6, twoPi - 1e-9, twoPi, twoPi + 1, 10 * twoPi + 0.5 };
+	for (double angle : angles)
+	{
+		const double decoded = roundTripAngle(angle);
+		CHECK(decoded >= 0 && decoded < twoPi);
+		CHECK(withinBound(angleDifference(decoded, angle), angleBound));
+	}
+
+	/* Angles just below a full turn wrap around to zero */
+	CHECK(roundTripAngle(twoPi - 1e-9) == 0);
+	CHECK(roundTripAngle(-1e-9) == 0);
+}
+
+void runQuantizationTests()
+{
+	testCoords();
+	testSpeed();
+	testAngle();
+}
@@ -0,0 +1,161 @@
+#include "tests.h"
+#include "unitsmanager.h"
+#include "weaponsmanager.h"
+#include "unit.h"
+#include "ingest.h"
+#include "datasnapshot.h"
+#include "compression.h"
+#include "bytebuffer.h"
+#include "defines.h"
+
+#include <zlib.h>
+#include <zstd.h>
+
+extern UnitsManager *unitsManager;
+extern WeaponsManager *weaponsManager;
+
+/* Compression of the data responses (see compressResponseBody and Server::create_data_response). The body of a full units request is compressed with
+	each encoding: it must decompress to the same bytes and its compression ratio must stay below compressionRatioBound. Bodies are only compressed from
+	COMPRESSION_MIN_SIZE on, where the compression already makes them smaller */
+static const unsigned int unitsCount = 1000;
+static const double compressionRatioBound = 0.5;
+
+static void createUnits(UnitsManager *manager)
+{
+	FrameBuffer<UnitFrame> buffer;
+	for (unsigned int ID = 1; ID <= unitsCount; ID++)
+	{
+		UnitFrame &frame = buffer.next();
+		frame.ID = ID;
+		frame.full = true;
+		frame.category = ID % 2 == 0 ? "Aircraft" : "GroundUnit";
+		frame.name = ID % 2 == 0 ? "F-16C_50" : "T-72B";
+		frame.coalition = static_cast<unsigned char>(ID % 2 + 1);
+		frame.position = Coords{ 42 + (ID % 100) * 0.01234, 41 + (ID / 100) * 0.05678, 500 + ID };
+		frame.heading = ID * 0.1;
+		frame.track = ID * 0.1;
+		frame.speed = ID % 2 == 0 ? 250 : 10;
+		frame.alive = true;
+		frame.hasControllerData = true;
+		frame.unitName = "Unit " + to_string(ID);
+		frame.groupName = "Group " + to_string(ID / 4);
+		frame.fuel = 0.8;
+		frame.health = 100;
+	}
+	manager->update(buffer);
+}
+
+static string decompress(const string &data, ContentEncoding encoding, size_t size)
+{
+	string decompressed(size, '\0');
+	if (encoding == ContentEncoding::deflate)
+	{
+		uLongf length = static_cast<uLongf>(size);
+		if (uncompress((Bytef *)decompressed.data(), &length, (const Bytef *)data.data(), static_cast<uLong>(data.size())) != Z_OK)
+			return "";
+		decompressed.resize(length);
+	}
+	else
+	{
+		const size_t length = ZSTD_decompress(decompressed.data(), size, data.data(), data.size());
+		if (ZSTD_isError(length))
+			return "";
+		decompressed.resize(length);
+	}
+	return decompressed;
+}
+
+static void testEncodingNegotiation()
+{
+	CHECK(negotiateContentEncoding("") == ContentEncoding::identity);
+	CHECK(negotiateContentEncoding("gzip, deflate, br") == ContentEncoding::deflate);
+	CHECK(negotiateContentEncoding("gzip, deflate, br, zstd") == ContentEncoding::zstd);
+	CHECK(negotiateContentEncoding("ZSTD;q=0.5, deflate") == ContentEncoding::zstd);
+	CHECK(negotiateContentEncoding("zstd;q=0, deflate") == ContentEncoding::deflate);
+	CHECK(negotiateContentEncoding("zstd;q=0.0, deflate;q=0") == ContentEncoding::identity);
+}
+
+static void testCompression(const string &body)
+{
+	for (ContentEncoding encoding : { ContentEncoding::deflate, ContentEncoding::zstd })
+	{
+		const string name = getContentEncodingName(encoding);
+
+		/* Full response */
+		string compressed = body;
+		CHECK(compressResponseBody(compressed, encoding));
+		CHECK(decompress(compressed, encoding, body.size()) == body);
+		const double ratio = static_cast<double>(compressed.size()) / body.size();
+		cout << "Units data of " << body.size() << " bytes, compressed to " << compressed.size() << " bytes with " << name << endl;
+		CHECK(ratio < compressionRatioBound);
+
+		/* Bodies just below the threshold are sent as they are */
+		string small = body.substr(0, COMPRESSION_MIN_SIZE - 1);
+		CHECK(!compressResponseBody(small, encoding));
+		CHECK(small == body.substr(0, COMPRESSION_MIN_SIZE - 1));
+
+		/* Bodies at the threshold are compressed, and the compression already pays off */
+		string threshold = body.substr(0, COMPRESSION_MIN_SIZE);
+		CHECK(compressResponseBody(threshold, encoding));
+		CHECK(threshold.size() < COMPRESSION_MIN_SIZE);
+		CHECK(decompress(threshold, encoding, COMPRESSION_MIN_SIZE) == body.substr(0, COMPRESSION_MIN_SIZE));
+	}
+
+	/* Clients which do not accept any compression get the body as it is */
+	string identity = body;
+	CHECK(!compressResponseBody(identity, ContentEncoding::identity));
+	CHECK(identity == body);
+}
+
+static void testResponseCache()
+{
+	CompressedResponseCache cache;
+	string body;
+	cache.put(2, "units", "second");
+	CHECK(cache.get(2, "units", body) && body == "second");
+	CHECK(!cache.get(2, "weapons", body));
+	CHECK(!cache.get(3, "units", body));
+
+	/* An older version does not replace the cache, a newer one empties it */
+	cache.put(1, "units", "first");
+	CHECK(cache.get(2, "units", body) && body == "second");
+	cache.put(3, "weapons", "third");
+	CHECK(!cache.get(2, "units", body));
+	CHECK(cache.get(3, "weapons", body) && body == "third");
+
+	/* The cache holds at most COMPRESSION_CACHE_SIZE bodies per version */
+	for (unsigned int i = 0; i <= COMPRESSION_CACHE_SIZE; i++)
+		cache.put(4, "units " + to_string(i), "fourth");
+	CHECK(cache.get(4, "units 0", body));
+	CHECK(!cache.get(4, "units " + to_string(COMPRESSION_CACHE_SIZE), body));
+}
+
+void runCompressionTests()
+{
+	lua_State *L = newTestState();
+	weaponsManager = new WeaponsManager(L);
+	UnitsManager *manager = new UnitsManager(L);
+	unitsManager = manager;
+	createUnits(manager);
+	DataSnapshot::publish();
+	auto snapshot = DataSnapshot::getLatest();
+	CHECK(snapshot->units.size() == unitsCount);
+
+	DataRequest request;
+	ByteBuffer buffer;
+	snapshot->getUnitData(buffer, request);
+	const string body = buffer.release();
+	CHECK(body.size() > COMPRESSION_MIN_SIZE);
+
+	testEncodingNegotiation();
+	testCompression(body);
+	testResponseCache();
+
+	for (auto const &p : manager->getUnits())
+		delete p.second;
+	delete manager;
+	unitsManager = nullptr;
+	delete weaponsManager;
+	weaponsManager = nullptr;
+	lua_close(L);
+}
@@ -0,0 +1,213 @@
+#include "tests.h"
+#include "datasnapshot.h"
+
+#include <thread>
+#include <atomic>
+#include <chrono>
+using namespace std::chrono;
+
+/* Publication of the data snapshots while other threads serialize them, as the ingest worker and the REST handlers do (see DataSnapshot). A writer
+	publishes a snapshot per tick, sharing the objects which did not change with the previous one. The readers check that the versions they load never
+	go back, that a snapshot serializes to the same bytes every time, and that the blocks of each object match its versions. The time the writer takes
+	for each tick is measured without readers, then with the readers spinning, and the 99th percentile must stay close to the one without readers */
+static const unsigned int unitsCount = 1024;
+static const unsigned int ticksCount = 2000;
+static const unsigned int maxReadersCount = 4;
+static const unsigned int updatePeriod = 4;		/* Each unit changes every updatePeriod ticks */
+static const double jitterFactor = 4;			/* Bound of the 99th percentile of the tick time with readers, relative to the one without readers */
+static const double jitterMargin = 250;			/* Plus this margin, in microseconds, for the timer and scheduling noise */
+
+static shared_ptr<const string> makeCategoryBlock()
+{
+	const string category = "Aircraft";
+	string block;
+	block.push_back(static_cast<char>(DataIndex::category));
+	const unsigned short size = static_cast<unsigned short>(category.size());
+	block.append(reinterpret_cast<const char *>(&size), sizeof(size));
+	block.append(category);
+	return make_shared<const string>(block);
+}
+
+/* The position block of the test units holds the version of the change instead of a position, so that the readers can check it */
+static shared_ptr<const string> makeVersionBlock(unsigned long long version)
+{
+	string block;
+	block.push_back(static_cast<char>(DataIndex::position));
+	block.append(reinterpret_cast<const char *>(&version), sizeof(version));
+	return make_shared<const string>(block);
+}
+
+static shared_ptr<const ObjectSnapshot> makeUnit(unsigned int ID, unsigned long long version, const shared_ptr<const string> &categoryBlock)
+{
+	auto unit = make_shared<ObjectSnapshot>();
+	unit->ID = ID;
+	unit->alive = true;
+	unit->updateVersions[DataIndex::category] = 1;
+	unit->updateVersions[DataIndex::position] = version;
+	unit->lastUpdateVersion = version;
+	unit->blocks[DataProtocol::standard - 1][DataIndex::category] = categoryBlock;
+	unit->blocks[DataProtocol::standard - 1][DataIndex::position] = makeVersionBlock(version);
+	return unit;
+}
+
+template <typename T>
+static bool read(const string &data, size_t &offset, T &value)
+{
+	if (offset + sizeof(T) > data.size())
+		return false;
+	memcpy(&value, data.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+/* Returns the number of units in the data, or -1 if the data is inconsistent with the snapshot */
+static int checkUnitData(const string &data, unsigned long long snapshotVersion)
+{
+	int count = 0;
+	size_t offset = 0;
+	while (offset < data.size())
+	{
+		unsigned int ID = 0;
+		if (!read(data, offset, ID) || ID == 0 || ID > unitsCount)
+			return -1;
+
+		unsigned char datumIndex = 0;
+		while (read(data, offset, datumIndex) && datumIndex != DataIndex::endOfData)
+		{
+			if (datumIndex == DataIndex::category)
+			{
+				unsigned short size = 0;
+				if (!read(data, offset, size) || data.compare(offset, size, "Aircraft") != 0)
+					return -1;
+				offset += size;
+			}
+			else if (datumIndex == DataIndex::position)
+			{
+				/* All the units are created on the first tick, then each one changes every updatePeriod ticks, on the ticks given by its ID */
+				unsigned long long version = 0;
+				if (!read(data, offset, version) || version > snapshotVersion || (version != 1 && version % updatePeriod != ID % updatePeriod))
+					return -1;
+				if (snapshotVersion >= updatePeriod && version + updatePeriod <= snapshotVersion)
+					return -1;
+			}
+			else
+				return -1;
+		}
+		if (datumIndex != DataIndex::endOfData)
+			return -1;
+		count++;
+	}
+	return count;
+}
+
+/* Publishes ticksCount snapshots, and returns the time taken by each tick, in microseconds */
+static vector<double> writeSnapshots(atomic<bool> &done)
+{
+	const auto categoryBlock = makeCategoryBlock();
+	vector<shared_ptr<const ObjectSnapshot>> units(unitsCount);
+	vector<double> tickTimes;
+	tickTimes.reserve(ticksCount);
+
+	for (unsigned long long version = 1; version <= ticksCount; version++)
+	{
+		const auto start = steady_clock::now();
+		auto snapshot = make_shared<DataSnapshot>();
+		snapshot->version = version;
+		for (unsigned int ID = 1; ID <= unitsCount; ID++)
+		{
+			if (units[ID - 1] == nullptr || version % updatePeriod == ID % updatePeriod)
+				units[ID - 1] = makeUnit(ID, version, categoryBlock);
+		}
+		snapshot->units = units;
+		DataSnapshot::publish(snapshot);
+		tickTimes.push_back(duration<double, micro>(steady_clock::now() - start).count());
+	}
+	done = true;
+	return tickTimes;
+}
+
+static double getPercentile(vector<double> samples, double percentile)
+{
+	auto element = samples.begin() + static_cast<size_t>((samples.size() - 1) * percentile);
+	nth_element(samples.begin(), element, samples.end());
+	return *element;
+}
+
+static void readSnapshots(const atomic<bool> &done, atomic<int> &failures, atomic<int> &reads)
+{
+	unsigned long long lastVersion = 0;
+	do
+	{
+		auto snapshot = DataSnapshot::getLatest();
+		if (snapshot->version < lastVersion)
+			failures++;
+		lastVersion = snapshot->version;
+
+		DataRequest request;
+		ByteBuffer first;
+		ByteBuffer second;
+		snapshot->getUnitData(first, request);
+		snapshot->getUnitData(second, request);
+		const string firstData = first.release();
+		if (firstData != second.release())
+			failures++;
+
+		const int count = checkUnitData(firstData, snapshot->version);
+		if (count != static_cast<int>(snapshot->units.size()))
+			failures++;
+
+		/* Only the units changed in the last tick are sent in the delta */
+		if (snapshot->version > updatePeriod)
+		{
+			request.time = snapshot->version - 1;
+			ByteBuffer delta;
+			snapshot->getUnitData(delta, request);
+			if (checkUnitData(delta.release(), snapshot->version) != static_cast<int>(unitsCount / updatePeriod))
+				failures++;
+		}
+		reads++;
+	} while (!done);
+}
+
+void runDataSnapshotTests()
+{
+	/* As on startup, the readers always find a snapshot */
+	DataSnapshot::publish(make_shared<DataSnapshot>());
+
+	/* Baseline, without readers */
+	atomic<bool> done = false;
+	const vector<double> baseline = writeSnapshots(done);
+
+	/* The readers get a core each, so that the measure shows the contention on the snapshot and not the sharing of the cores */
+	const unsigned int cores = thread::hardware_concurrency();
+	const unsigned int readersCount = cores > 1 ? min(maxReadersCount, cores - 1) : 1;
+
+	done = false;
+	atomic<int> failures = 0;
+	atomic<int> reads = 0;
+	vector<double> loaded;
+
+	DataSnapshot::publish(make_shared<DataSnapshot>());
+	vector<thread> readers;
+	for (unsigned int i = 0; i < readersCount; i++)
+		readers.emplace_back(readSnapshots, cref(done), ref(failures), ref(reads));
+	thread writer([&done, &loaded]() { loaded = writeSnapshots(done); });
+
+	writer.join();
+	for (auto &reader : readers)
+		reader.join();
+
+	CHECK(failures == 0);
+	CHECK(reads > 0);
+	CHECK(DataSnapshot::getLatest()->version == ticksCount);
+	CHECK(DataSnapshot::getLatest()->units.size() == unitsCount);
+
+	const double baselineP99 = getPercentile(baseline, 0.99);
+	const double loadedP99 = getPercentile(loaded, 0.99);
+	cout << "Snapshot tick time, p99/max in microseconds: " << baselineP99 << "/" << getPercentile(baseline, 1) << " without readers, " <<
+		loadedP99 << "/" << getPercentile(loaded, 1) << " with " << readersCount << " readers" << endl;
+	if (cores > readersCount)
+		CHECK(loadedP99 <= baselineP99 * jitterFactor + jitterMargin);
+	else
+		cout << "Not enough cores to give the readers their own, the tick time bound is not checked" << endl;
+}
@@ -0,0 +1,191 @@
+#include "tests.h"
+#include "unitsmanager.h"
+#include "unit.h"
+#include "ingest.h"
+#include "geodesy.h"
+
+#include <random>
+#include <chrono>
+using namespace std::chrono;
+
+extern UnitsManager *unitsManager;
+
+/* Distances and spatial queries (see geodesy.h and SpatialIndex). The local tangent plane approximation must stay within its documented bound of the
+	geodesic on theatre sized distances, and the closest unit and range queries of the index must give the same result as a scan of all the units
+	computing the geodesic of each one. The units are spread over the Caucasus, with a few clusters near the pole where the approximation is not valid */
+static const unsigned int unitsCount = 2000;
+static const unsigned int queriesCount = 200;
+static const unsigned int pairsCount = 100000;
+static const double queryRanges[] = { 5000, 50000, 300000, 1000000 };
+static const vector<string> allCategories = { "Aircraft", "Helicopter", "GroundUnit", "NavyUnit" };
+
+static Coords getRandomPosition(mt19937 &generator, unsigned int ID)
+{
+	uniform_real_distribution<double> unit(0, 1);
+	if (ID % 20 == 0)
+		return Coords{ 80 + 6 * unit(generator), -60 + 120 * unit(generator), 1000 * unit(generator) };
+	return Coords{ 40 + 5 * unit(generator), 36 + 11 * unit(generator), 10000 * unit(generator) };
+}
+
+static void createUnits(UnitsManager *manager, mt19937 &generator)
+{
+	FrameBuffer<UnitFrame> buffer;
+	for (unsigned int ID = 1; ID <= unitsCount; ID++)
+	{
+		UnitFrame &frame = buffer.next();
+		frame.ID = ID;
+		frame.full = true;
+		frame.category = allCategories[ID % 4];
+		frame.name = "F-16C_50";
+		frame.coalition = static_cast<unsigned char>(ID % 3);
+		frame.position = getRandomPosition(generator, ID);
+		frame.alive = ID % 13 != 0;
+		frame.hasControllerData = true;
+		frame.unitName = "Unit " + to_string(ID);
+		frame.groupName = "Group " + to_string(ID);
+	}
+	manager->update(buffer);
+}
+
+static bool isCandidate(Unit *unit, unsigned char coalition, const vector<string> &categories)
+{
+	return unit->getAlive() && unit->getCoalition() == coalition && find(categories.begin(), categories.end(), unit->getCategory()) != categories.end();
+}
+
+static void testApproximation(mt19937 &generator)
+{
+	unsigned int outOfBound = 0;
+	unsigned int wrongComparisons = 0;
+	double approximationTime = 0;
+	double geodesicTime = 0;
+	double sum = 0;
+
+	uniform_real_distribution<double> unit(0, 1);
+	for (unsigned int i = 0; i < pairsCount; i++)
+	{
+		const Coords a{ 40 + 5 * unit(generator), 36 + 11 * unit(generator), 0 };
+		const Coords b{ a.lat + 2 * unit(generator) - 1, a.lng + 2 * unit(generator) - 1, 0 };
+
+		auto start = steady_clock::now();
+		const LocalTangentPlane plane(a);
+		const double approximation = plane.getApproximateDistance(b);
+		approximationTime += duration<double, micro>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		const double geodesic = geodesicDistance(a, b);
+		geodesicTime += duration<double, micro>(steady_clock::now() - start).count();
+		sum += approximation + geodesic;
+
+		if (plane.isApproximationValid(b, approximation) && abs(approximation - geodesic) > geodesic * GEODESY_RELATIVE_ERROR + GEODESY_ABSOLUTE_ERROR)
+			outOfBound++;
+
+		const double threshold = geodesic * (0.99 + 0.02 * unit(generator));
+		if (plane.isWithinDistance(b, threshold) != (geodesic < threshold))
+			wrongComparisons++;
+	}
+
+	CHECK(outOfBound == 0);
+	CHECK(wrongComparisons == 0);
+	CHECK(sum > 0);
+	cout << "Distance of " << pairsCount << " pairs, in milliseconds: " << approximationTime / 1000 << " with the tangent plane, " << geodesicTime / 1000 <<
+		" with the geodesic" << endl;
+	CHECK(approximationTime < geodesicTime);
+}
+
+static void testQueries(UnitsManager *manager, mt19937 &generator)
+{
+	unsigned int closestMismatches = 0;
+	unsigned int rangeMismatches = 0;
+	double indexTime = 0;
+	double scanTime = 0;
+
+	auto &units = manager->getUnits();
+	uniform_int_distribution<unsigned int> randomID(1, unitsCount);
+	for (unsigned int i = 0; i < queriesCount; i++)
+	{
+		Unit *origin = manager->getUnit(randomID(generator));
+		const unsigned char coalition = origin->getCoalition() == 1 ? 2 : 1;
+		const vector<string> categories = i % 2 == 0 ? allCategories : vector<string>{ "Aircraft", "GroundUnit" };
+		const Coords position = origin->getPosition();
+
+		/* Closest unit on the geodesic, the distance then includes the altitude difference */
+		auto start = steady_clock::now();
+		double distance = 0;
+		Unit *closest = manager->getClosestUnit(origin, coalition, categories, distance);
+		indexTime += duration<double, micro>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		Unit *expectedClosest = nullptr;
+		double closestGeodesic = 0;
+		for (auto const &p : units)
+		{
+			if (!isCandidate(p.second, coalition, categories))
+				continue;
+			const double candidateGeodesic = geodesicDistance(position, p.second->getPosition());
+			if (expectedClosest == nullptr || candidateGeodesic < closestGeodesic)
+			{
+				expectedClosest = p.second;
+				closestGeodesic = candidateGeodesic;
+			}
+		}
+		scanTime += duration<double, micro>(steady_clock::now() - start).count();
+
+		if (closest != expectedClosest)
+			closestMismatches++;
+		else if (closest != nullptr)
+		{
+			const double altDelta = position.alt - closest->getPosition().alt;
+			if (distance != sqrt(closestGeodesic * closestGeodesic + altDelta * altDelta))
+				closestMismatches++;
+		}
+
+		/* Units in range, on the geodesic only */
+		for (double range : queryRanges)
+		{
+			start = steady_clock::now();
+			const map<Unit *, double> inRange = manager->getUnitsInRange(origin, coalition, categories, range);
+			indexTime += duration<double, micro>(steady_clock::now() - start).count();
+
+			start = steady_clock::now();
+			map<Unit *, double> expectedInRange;
+			for (auto const &p : units)
+			{
+				if (!isCandidate(p.second, coalition, categories))
+					continue;
+				const double candidateDistance = geodesicDistance(position, p.second->getPosition());
+				if (candidateDistance <= range)
+					expectedInRange[p.second] = candidateDistance;
+			}
+			scanTime += duration<double, micro>(steady_clock::now() - start).count();
+
+			if (inRange != expectedInRange)
+				rangeMismatches++;
+		}
+	}
+
+	CHECK(closestMismatches == 0);
+	CHECK(rangeMismatches == 0);
+	cout << "Spatial queries on " << unitsCount << " units, in milliseconds: " << indexTime / 1000 << " with the index, " << scanTime / 1000 <<
+		" with a scan" << endl;
+	CHECK(indexTime < scanTime);
+}
+
+void runSpatialQueryTests()
+{
+	mt19937 generator(42);
+	testApproximation(generator);
+
+	lua_State *L = newTestState();
+	UnitsManager *manager = new UnitsManager(L);
+	unitsManager = manager;
+	createUnits(manager, generator);
+	CHECK(manager->getUnits().size() == unitsCount);
+
+	testQueries(manager, generator);
+
+	for (auto const &p : manager->getUnits())
+		delete p.second;
+	delete manager;
+	unitsManager = nullptr;
+	lua_close(L);
+}
@@ -0,0 +1,178 @@
+#include "tests.h"
+#include "unitsmanager.h"
+#include "unit.h"
+#include "ingest.h"
+
+#include <chrono>
+using namespace std::chrono;
+
+extern UnitsManager *unitsManager;
+
+/* Decoding of the units data table (see coreUnitsData). The same Olympus.unitsData table is applied every tick to two managers, one through the legacy
+	json path (luaTableToJSON and Unit::update(json)) and one through the typed decoder of the ingest pipeline (readUnitsData and Unit::update(frame)).
+	The units must end up in the same state, and the typed path must be cheaper per tick */
+static const unsigned int unitsCount = 500;		/* The json path is quadratic (luaTableToJSON copies the units table for each key), so the count is kept moderate */
+static const unsigned int ticksCount = 5;
+
+/* Stand-in for the data sent by Olympus.setUnitsData, in the nested table format. The kinematic data changes every tick */
+static const char *unitsDataScript = R"(
+	Olympus = { unitsData = { units = {} } }
+
+	local categories = { "Aircraft", "Helicopter", "GroundUnit", "NavyUnit" }
+	function fillUnitsData(count, tick)
+		local units = Olympus.unitsData.units
+		for ID = 1, count do
+			units[ID] = {
+				category = categories[ID % 4 + 1],
+				name = "F-16C_50",
+				coalitionID = ID % 3,
+				position = { lat = 42 + (ID % 100) * 0.01 + tick * 1e-4, lng = 41 + math.floor(ID / 100) * 0.01, alt = 1000 + tick },
+				heading = (ID + tick) % 6,
+				track = (ID + tick + 1) % 6,
+				speed = 200 + tick,
+				horizontalVelocity = 199 + tick,
+				verticalVelocity = tick % 3 - 1,
+				isAlive = ID % 50 ~= tick,
+				unitName = "Unit " .. ID,
+				groupName = "Group " .. math.floor((ID - 1) / 4),
+				isHuman = false,
+				hasTask = ID % 2 == 0,
+				fuel = 0.5,
+				health = 100,
+				ammo = { { count = 2, desc = { displayName = "AIM-120C", guidance = 4, category = 1, missileCategory = 1 } } },
+				contacts = { { object = { id_ = ID % count + 1 }, detectionMethod = "RADAR" } }
+			}
+		end
+	end
+)";
+
+static void fillUnitsData(lua_State *L, unsigned int tick)
+{
+	lua_getglobal(L, "fillUnitsData");
+	lua_pushnumber(L, unitsCount);
+	lua_pushnumber(L, tick);
+	lua_pcall(L, 2, 0, 0);
+}
+
+/* Applies the units data through the legacy json path, and returns the time it took in microseconds */
+static double applyJSON(lua_State *L, UnitsManager *manager, double dt)
+{
+	unitsManager = manager;
+	const auto start = steady_clock::now();
+
+	lua_getglobal(L, "Olympus");
+	lua_getfield(L, -1, "unitsData");
+	json unitsData = json::object();
+	luaTableToJSON(L, -1, unitsData);
+	lua_pop(L, 2);
+	manager->update(unitsData["units"], dt);
+
+	return duration<double, micro>(steady_clock::now() - start).count();
+}
+
+/* Applies the units data through the typed decoder, and returns the time it took in microseconds */
+static double applyFrames(lua_State *L, UnitsManager *manager, FrameBuffer<UnitFrame> &buffer, double dt)
+{
+	unitsManager = manager;
+	const auto start = steady_clock::now();
+
+	buffer.clear();
+	buffer.dt = dt;
+	lua_getglobal(L, "Olympus");
+	lua_getfield(L, -1, "unitsData");
+	readUnitsData(L, -1, buffer);
+	lua_pop(L, 2);
+	manager->update(buffer);
+
+	return duration<double, micro>(steady_clock::now() - start).count();
+}
+
+static bool isSameUnit(Unit *a, Unit *b)
+{
+	if (a == nullptr || b == nullptr)
+		return false;
+
+	const Coords positionA = a->getPosition();
+	const Coords positionB = b->getPosition();
+	if (positionA.lat != positionB.lat || positionA.lng != positionB.lng || positionA.alt != positionB.alt)
+		return false;
+
+	if (a->getCategory() != b->getCategory() || a->getName() != b->getName() || a->getUnitName() != b->getUnitName() ||
+		a->getGroupName() != b->getGroupName() || a->getCoalition() != b->getCoalition() || a->getAlive() != b->getAlive() ||
+		a->getHuman() != b->getHuman() || a->getHasTask() != b->getHasTask())
+		return false;
+
+	if (a->getHeading() != b->getHeading() || a->getTrack() != b->getTrack() || a->getSpeed() != b->getSpeed() ||
+		a->getHorizontalVelocity() != b->getHorizontalVelocity() || a->getVerticalVelocity() != b->getVerticalVelocity() ||
+		a->getFuel() != b->getFuel() || a->getHealth() != b->getHealth())
+		return false;
+
+	const auto ammoA = a->getAmmo();
+	const auto ammoB = b->getAmmo();
+	if (ammoA.size() != ammoB.size())
+		return false;
+	for (size_t i = 0; i < ammoA.size(); i++)
+	{
+		if (ammoA[i].quantity != ammoB[i].quantity || strcmp(ammoA[i].name, ammoB[i].name) != 0 || ammoA[i].guidance != ammoB[i].guidance ||
+			ammoA[i].category != ammoB[i].category || ammoA[i].missileCategory != ammoB[i].missileCategory)
+			return false;
+	}
+
+	const auto contactsA = a->getContacts();
+	const auto contactsB = b->getContacts();
+	if (contactsA.size() != contactsB.size())
+		return false;
+	for (size_t i = 0; i < contactsA.size(); i++)
+	{
+		if (contactsA[i].ID != contactsB[i].ID || contactsA[i].detectionMethod != contactsB[i].detectionMethod)
+			return false;
+	}
+	return true;
+}
+
+void runUnitsDataTests()
+{
+	lua_State *L = newTestState();
+	CHECK(luaL_dostring(L, unitsDataScript) == 0);
+
+	UnitsManager *jsonManager = new UnitsManager(L);
+	UnitsManager *framesManager = new UnitsManager(L);
+	FrameBuffer<UnitFrame> buffer;
+
+	/* The first tick creates the units, it is not measured */
+	fillUnitsData(L, 0);
+	applyJSON(L, jsonManager, 0);
+	applyFrames(L, framesManager, buffer, 0);
+
+	double jsonTime = 0;
+	double framesTime = 0;
+	for (unsigned int tick = 1; tick <= ticksCount; tick++)
+	{
+		fillUnitsData(L, tick);
+		jsonTime += applyJSON(L, jsonManager, 0.2);
+		framesTime += applyFrames(L, framesManager, buffer, 0.2);
+	}
+
+	CHECK(jsonManager->getUnits().size() == unitsCount);
+	CHECK(framesManager->getUnits().size() == unitsCount);
+	unsigned int mismatches = 0;
+	for (unsigned int ID = 1; ID <= unitsCount; ID++)
+	{
+		if (!isSameUnit(jsonManager->getUnit(ID), framesManager->getUnit(ID)))
+			mismatches++;
+
+		/* The json path applies the units in the order of the string keys, so the leader flag set during the update may differ, but not the leader */
+		Unit *jsonLeader = jsonManager->getGroupLeader(ID);
+		Unit *framesLeader = framesManager->getGroupLeader(ID);
+		if ((jsonLeader == nullptr) != (framesLeader == nullptr) || (jsonLeader != nullptr && jsonLeader->getID() != framesLeader->getID()))
+			mismatches++;
+	}
+	CHECK(mismatches == 0);
+
+	cout << "Units data tick with " << unitsCount << " units, in microseconds: " << jsonTime / ticksCount << " with the json path, " <<
+		framesTime / ticksCount << " with the typed decoder" << endl;
+	CHECK(framesTime < jsonTime);
+
+	unitsManager = nullptr;
+	lua_close(L);
+}
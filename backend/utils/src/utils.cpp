@@ -1,6 +1,8 @@
 #include "framework.h"
 #include "utils.h"
 
+#include <random>
+
 // Get current date/time, format is YYYY-MM-DD.HH:mm:ss
 const std::string CurrentDateTime()
 {
@@ -46,20 +48,18 @@ std::string to_string(const std::wstring &wstr)
     return result;
 }
 
+// The generator is seeded once per thread. Seeding rand() with the time on every call gave the same string to all the calls within the same second,
+// so that the commands created together shared their hash
 std::string random_string(size_t length)
 {
-    srand(static_cast<unsigned int>(time(NULL)));
-    auto randchar = []() -> char
-    {
-        const char charset[] =
-            "0123456789"
-            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-            "abcdefghijklmnopqrstuvwxyz";
-        const size_t max_index = (sizeof(charset) - 1);
-        return charset[rand() % max_index];
-    };
+    static thread_local std::mt19937 generator(std::random_device{}());
+    const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+    std::uniform_int_distribution<size_t> distribution(0, sizeof(charset) - 2);
     std::string str(length, 0);
-    std::generate_n(str.begin(), length, randchar);
+    std::generate_n(str.begin(), length, [&]() { return charset[distribution(generator)]; });
     return str;
 }
 
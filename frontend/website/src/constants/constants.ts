@@ -9,6 +9,9 @@ export const BULLSEYE_URI = "bullseyes";
 export const MISSION_URI = "mission";
 export const COMMANDS_URI = "commands";
 
+/* Version of the units and weapons binary protocol. The version 2 quantizes the position, speeds and angles */
+export const DATA_PROTOCOL = 2;
+
 export const NONE = "None";
 export const GAME_MASTER = "Game master";
 export const BLUE_COMMANDER = "Blue commander";
@@ -305,6 +308,7 @@ export enum DataIndexes {
     shotsScatter,
     shotsIntensity,
     health,
+    removed = 254,
     endOfData = 255
 };
 
@@ -68,6 +68,7 @@ export interface LogData {
 export interface ServerRequestOptions {
     time?: number;
     commandHash?: string;
+    protocol?: number;
 }
 
 export interface UnitSpawnTable {
@@ -25,7 +25,8 @@ export class TemporaryUnitMarker extends CustomMarker {
         this.#timer = window.setInterval(() => { 
             if (this.#commandHash !== undefined)  {
                 getApp().getServerManager().isCommandExecuted((res: any) => {
-                    if (res.commandExecuted) {
+                    /* Failed and unknown commands will never spawn the unit, stop waiting for them */
+                    if (res.commandExecuted || res.commandStatus === "failed" || res.commandStatus === "unknown") {
                         this.removeFrom(getApp().getMap());
                         window.clearInterval(this.#timer);
                     }
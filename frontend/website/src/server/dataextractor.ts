@@ -6,9 +6,11 @@ export class DataExtractor {
     #dataview: DataView;
     #decoder: TextDecoder;
     #buffer: ArrayBuffer;
+    #protocol: number;
 
-    constructor(buffer: ArrayBuffer) {
+    constructor(buffer: ArrayBuffer, protocol: number = 1) {
         this.#buffer = buffer;
+        this.#protocol = protocol;
         this.#dataview = new DataView(this.#buffer);
         this.#decoder = new TextDecoder("utf-8");
     }
@@ -61,6 +63,38 @@ export class DataExtractor {
         return new LatLng(this.extractFloat64(), this.extractFloat64(), this.extractFloat64())
     }
 
+    /* In the protocol version 2 the position is fixed point, lat and lng in 1e-7 degrees and alt in cm */
+    extractPosition() {
+        if (this.#protocol < 2)
+            return this.extractLatLng();
+
+        const lat = this.#dataview.getInt32(this.#seekPosition, true) / 1e7;
+        const lng = this.#dataview.getInt32(this.#seekPosition + 4, true) / 1e7;
+        const alt = this.#dataview.getInt32(this.#seekPosition + 8, true) / 100;
+        this.#seekPosition += 12;
+        return new LatLng(lat, lng, alt);
+    }
+
+    /* In the protocol version 2 speeds are int16 in 0.1 m/s steps */
+    extractSpeed() {
+        if (this.#protocol < 2)
+            return this.extractFloat64();
+
+        const value = this.#dataview.getInt16(this.#seekPosition, true) / 10;
+        this.#seekPosition += 2;
+        return value;
+    }
+
+    /* In the protocol version 2 angles are uint16 in 2pi / 65536 rad steps */
+    extractAngle() {
+        if (this.#protocol < 2)
+            return this.extractFloat64();
+
+        const value = this.#dataview.getUint16(this.#seekPosition, true) / 65536 * 2 * Math.PI;
+        this.#seekPosition += 2;
+        return value;
+    }
+
     extractFromBitmask(bitmask: number, position: number) {
         return ((bitmask >> position) & 1) > 0;
     }
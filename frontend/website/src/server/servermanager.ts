@@ -1,6 +1,6 @@
 import { LatLng } from 'leaflet';
 import { getApp } from '..';
-import { AIRBASES_URI, BULLSEYE_URI, COMMANDS_URI, LOGS_URI, MISSION_URI, NONE, ROEs, UNITS_URI, WEAPONS_URI, emissionsCountermeasures, reactionsToThreat } from '../constants/constants';
+import { AIRBASES_URI, BULLSEYE_URI, COMMANDS_URI, DATA_PROTOCOL, LOGS_URI, MISSION_URI, NONE, ROEs, UNITS_URI, WEAPONS_URI, emissionsCountermeasures, reactionsToThreat } from '../constants/constants';
 import { ServerStatusPanel } from '../panels/serverstatuspanel';
 import { LogPanel } from '../panels/logpanel';
 import { Popup } from '../popups/popup';
@@ -22,8 +22,9 @@ export class ServerManager {
     #requests: { [key: string]: XMLHttpRequest } = {};
 
     constructor() {
-        this.#lastUpdateTimes[UNITS_URI] = Date.now();
-        this.#lastUpdateTimes[WEAPONS_URI] = Date.now();
+        /* Units and weapons are versioned by the server with a monotonic counter, start from a full update */
+        this.#lastUpdateTimes[UNITS_URI] = 0;
+        this.#lastUpdateTimes[WEAPONS_URI] = 0;
         this.#lastUpdateTimes[LOGS_URI] = Date.now();
         this.#lastUpdateTimes[AIRBASES_URI] = Date.now();
         this.#lastUpdateTimes[BULLSEYE_URI] = Date.now();
@@ -50,11 +51,14 @@ export class ServerManager {
             this.#requests[uri] = xmlHttp;
 
         /* Assemble the request options string */
-        var optionsString = '';
+        var optionsList: string[] = [];
         if (options?.time != undefined)
-            optionsString = `time=${options.time}`;
+            optionsList.push(`time=${options.time}`);
         if (options?.commandHash != undefined)
-            optionsString = `commandHash=${options.commandHash}`;
+            optionsList.push(`commandHash=${options.commandHash}`);
+        if (options?.protocol != undefined)
+            optionsList.push(`protocol=${options.protocol}`);
+        var optionsString = optionsList.join('&');
 
         /* On the connection */
         xmlHttp.open("GET", `${this.#REST_ADDRESS}/${uri}${optionsString ? `?${optionsString}` : ''}`, true);
@@ -146,11 +150,11 @@ export class ServerManager {
     }
 
     getUnits(callback: CallableFunction, refresh: boolean = false) {
-        this.GET(callback, UNITS_URI, { time: refresh ? 0 : this.#lastUpdateTimes[UNITS_URI] }, 'arraybuffer', refresh);
+        this.GET(callback, UNITS_URI, { time: refresh ? 0 : this.#lastUpdateTimes[UNITS_URI], protocol: DATA_PROTOCOL }, 'arraybuffer', refresh);
     }
 
     getWeapons(callback: CallableFunction, refresh: boolean = false) {
-        this.GET(callback, WEAPONS_URI, { time: refresh ? 0 : this.#lastUpdateTimes[WEAPONS_URI] }, 'arraybuffer', refresh);
+        this.GET(callback, WEAPONS_URI, { time: refresh ? 0 : this.#lastUpdateTimes[WEAPONS_URI], protocol: DATA_PROTOCOL }, 'arraybuffer', refresh);
     }
 
     isCommandExecuted(callback: CallableFunction, commandHash: string) {
@@ -477,11 +481,6 @@ export class ServerManager {
 
         this.#intervals.push(window.setInterval(() => {
             if (!this.getPaused() && getApp().getMissionManager().getCommandModeOptions().commandMode != NONE) {
-                this.getUnits((buffer: ArrayBuffer) => {
-                    var time = getApp().getUnitsManager()?.update(buffer);
-                    return time;
-                }, true);
-
                 const elapsedMissionTime = getApp().getMissionManager().getDateAndTime().elapsedTime;
                 this.#serverIsPaused = (elapsedMissionTime === this.#previousMissionElapsedTime);
                 this.#previousMissionElapsedTime = elapsedMissionTime;
@@ -517,15 +516,6 @@ export class ServerManager {
             csp.setElapsedTime(new Date(elapsedMissionTime * 1000).toISOString().substring(11, 19));
 
         }, 1000));
-
-        this.#intervals.push(window.setInterval(() => {
-            if (!this.getPaused() && getApp().getMissionManager().getCommandModeOptions().commandMode != NONE) {
-                this.getWeapons((buffer: ArrayBuffer) => {
-                    var time = getApp().getWeaponsManager()?.update(buffer);
-                    return time;
-                }, true);
-            }
-        }, 5000));
     }
 
     refreshAll() {
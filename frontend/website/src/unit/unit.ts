@@ -97,6 +97,7 @@ export abstract class Unit extends CustomMarker {
     #group: Group | null = null;
     #selected: boolean = false;
     #hidden: boolean = false;
+    #removed: boolean = false;
     #highlighted: boolean = false;
     #waitingForDoubleClick: boolean = false;
     #pathMarkers: Marker[] = [];
@@ -267,11 +268,14 @@ export abstract class Unit extends CustomMarker {
         var updateMarker = !getApp().getMap().hasLayer(this);
 
         var oldIsLeader = this.#isLeader;
+        var removalNotice = false;
         var datumIndex = 0;
         while (datumIndex != DataIndexes.endOfData) {
             datumIndex = dataExtractor.extractUInt8();
             switch (datumIndex) {
                 case DataIndexes.category: dataExtractor.extractString(); break;
+                /* The unit left the requested area or is no longer visible. Its data is out of date until it is sent again in full */
+                case DataIndexes.removed: removalNotice = true; updateMarker = true; break;
                 case DataIndexes.alive: this.setAlive(dataExtractor.extractBool()); updateMarker = true; break;
                 case DataIndexes.human: this.#human = dataExtractor.extractBool(); break;
                 case DataIndexes.controlled: this.#controlled = dataExtractor.extractBool(); updateMarker = true; break;
@@ -283,12 +287,12 @@ export abstract class Unit extends CustomMarker {
                 case DataIndexes.state: this.#state = enumToState(dataExtractor.extractUInt8()); updateMarker = true; break;
                 case DataIndexes.task: this.#task = dataExtractor.extractString(); break;
                 case DataIndexes.hasTask: this.#hasTask = dataExtractor.extractBool(); break;
-                case DataIndexes.position: this.#position = dataExtractor.extractLatLng(); updateMarker = true; break;
-                case DataIndexes.speed: this.#speed = dataExtractor.extractFloat64(); updateMarker = true; break;
-                case DataIndexes.horizontalVelocity: this.#horizontalVelocity = dataExtractor.extractFloat64(); break;
-                case DataIndexes.verticalVelocity: this.#verticalVelocity = dataExtractor.extractFloat64(); break;
-                case DataIndexes.heading: this.#heading = dataExtractor.extractFloat64(); updateMarker = true; break;
-                case DataIndexes.track: this.#track = dataExtractor.extractFloat64(); updateMarker = true; break;
+                case DataIndexes.position: this.#position = dataExtractor.extractPosition(); updateMarker = true; break;
+                case DataIndexes.speed: this.#speed = dataExtractor.extractSpeed(); updateMarker = true; break;
+                case DataIndexes.horizontalVelocity: this.#horizontalVelocity = dataExtractor.extractSpeed(); break;
+                case DataIndexes.verticalVelocity: this.#verticalVelocity = dataExtractor.extractSpeed(); break;
+                case DataIndexes.heading: this.#heading = dataExtractor.extractAngle(); updateMarker = true; break;
+                case DataIndexes.track: this.#track = dataExtractor.extractAngle(); updateMarker = true; break;
                 case DataIndexes.isActiveTanker: this.#isActiveTanker = dataExtractor.extractBool(); break;
                 case DataIndexes.isActiveAWACS: this.#isActiveAWACS = dataExtractor.extractBool(); break;
                 case DataIndexes.onOff: this.#onOff = dataExtractor.extractBool(); break;
@@ -319,8 +323,11 @@ export abstract class Unit extends CustomMarker {
             }
         }
 
-        /* Dead and hidden units can't be selected */
-        this.setSelected(this.getSelected() && this.#alive && !this.getHidden())
+        /* A removal notice is always sent on its own, so any other data means the unit is back in the area or visible again */
+        this.#removed = removalNotice;
+
+        /* Dead, hidden and removed units can't be selected */
+        this.setSelected(this.getSelected() && this.#alive && !this.getHidden() && !this.#removed)
 
         /* Update the marker if required */
         if (updateMarker)
@@ -714,8 +721,8 @@ export abstract class Unit extends CustomMarker {
             (getApp().getMap().getVisibilityOptions()[HIDE_GROUP_MEMBERS] && !this.#isLeader && !this.getSelected() && this.getCategory() == "GroundUnit" && getApp().getMap().getZoom() < GROUPING_ZOOM_TRANSITION && 
             (this.belongsToCommandedCoalition() || (!this.belongsToCommandedCoalition() && this.#detectionMethods.length == 0))));
 
-        /* Force dead units to be hidden */
-        this.setHidden(hidden || !this.getAlive());
+        /* Force dead units, and units whose data is out of date after a removal notice, to be hidden */
+        this.setHidden(hidden || !this.getAlive() || this.#removed);
     }
 
     setHidden(hidden: boolean) {
@@ -750,6 +757,10 @@ export abstract class Unit extends CustomMarker {
         return this.#hidden;
     }
 
+    getRemoved() {
+        return this.#removed;
+    }
+
     setDetectionMethods(newDetectionMethods: number[]) {
         if (!this.belongsToCommandedCoalition()) {
             /* Check if the detection methods of this unit have changed */
@@ -1110,7 +1121,7 @@ export abstract class Unit extends CustomMarker {
 
         /* Draw the minimap marker */
         var drawMiniMapMarker = (this.belongsToCommandedCoalition() || this.getDetectionMethods().some(value => [VISUAL, OPTIC, RADAR, IRST, DLINK].includes(value)));
-        if (this.#alive && drawMiniMapMarker) {
+        if (this.#alive && !this.#removed && drawMiniMapMarker) {
             if (this.#miniMapMarker == null) {
                 this.#miniMapMarker = new CircleMarker(new LatLng(this.#position.lat, this.#position.lng), { radius: 0.5 });
                 if (this.#coalition == "neutral")
@@ -4,7 +4,7 @@ import { Unit } from "./unit";
 import { bearingAndDistanceToLatLng, deg2rad, getGroundElevation, getUnitDatabaseByCategory, keyEventWasInInput, latLngToMercator, mToFt, mercatorToLatLng, msToKnots, polyContains, polygonArea, randomPointInPoly, randomUnitBlueprint } from "../other/utils";
 import { CoalitionArea } from "../map/coalitionarea/coalitionarea";
 import { groundUnitDatabase } from "./databases/groundunitdatabase";
-import { DELETE_CYCLE_TIME, DELETE_SLOW_THRESHOLD, DataIndexes, GAME_MASTER, IADSDensities, IDLE, MOVE_UNIT } from "../constants/constants";
+import { DATA_PROTOCOL, DELETE_CYCLE_TIME, DELETE_SLOW_THRESHOLD, DataIndexes, GAME_MASTER, IADSDensities, IDLE, MOVE_UNIT } from "../constants/constants";
 import { DataExtractor } from "../server/dataextractor";
 import { citiesDatabase } from "./databases/citiesdatabase";
 import { aircraftDatabase } from "./databases/aircraftdatabase";
@@ -153,7 +153,7 @@ export class UnitsManager {
         /* Extract the data from the arraybuffer. Since data is encoded dynamically (not all data is always present, but rather only the data that was actually updated since the last request).
         No a prori casting can be performed. On the contrary, the array is decoded incrementally, depending on the DataIndexes of the data. The actual data decoding is performed by the Unit class directly. 
         Every time a piece of data is decoded the decoder seeker is incremented. */
-        var dataExtractor = new DataExtractor(buffer);
+        var dataExtractor = new DataExtractor(buffer, DATA_PROTOCOL);
 
         var updateTime = Number(dataExtractor.extractUInt64());
 
@@ -169,9 +169,14 @@ export class UnitsManager {
                     const category = dataExtractor.extractString();
                     this.addUnit(ID, category);
                 }
+                else if (datumIndex == DataIndexes.removed) {
+                    /* Removal notice for a unit we never received, skip it */
+                    dataExtractor.extractUInt8();
+                    continue;
+                }
                 else {
-                    /* Inconsistent data, we need to wait for a refresh */
-                    return updateTime;
+                    /* Inconsistent data, request a full refresh */
+                    return 0;
                 }
             }
             /* Update the data of the unit */
@@ -60,9 +60,9 @@ export class Weapon extends CustomMarker {
                 case DataIndexes.alive: this.setAlive(dataExtractor.extractBool()); updateMarker = true; break;
                 case DataIndexes.coalition: this.#coalition = enumToCoalition(dataExtractor.extractUInt8()); break;
                 case DataIndexes.name: this.#name = dataExtractor.extractString(); break;
-                case DataIndexes.position: this.#position = dataExtractor.extractLatLng(); updateMarker = true; break;
-                case DataIndexes.speed: this.#speed = dataExtractor.extractFloat64(); updateMarker = true; break;
-                case DataIndexes.heading: this.#heading = dataExtractor.extractFloat64(); updateMarker = true; break;
+                case DataIndexes.position: this.#position = dataExtractor.extractPosition(); updateMarker = true; break;
+                case DataIndexes.speed: this.#speed = dataExtractor.extractSpeed(); updateMarker = true; break;
+                case DataIndexes.heading: this.#heading = dataExtractor.extractAngle(); updateMarker = true; break;
             }
         }
         
@@ -1,6 +1,6 @@
 import { getApp } from "..";
 import { Weapon } from "./weapon";
-import { DataIndexes } from "../constants/constants";
+import { DATA_PROTOCOL, DataIndexes } from "../constants/constants";
 import { DataExtractor } from "../server/dataextractor";
 import { Contact } from "../interfaces";
 
@@ -58,7 +58,7 @@ export class WeaponsManager {
         /* Extract the data from the arraybuffer. Since data is encoded dynamically (not all data is always present, but rather only the data that was actually updated since the last request).
         No a prori casting can be performed. On the contrary, the array is decoded incrementally, depending on the DataIndexes of the data. The actual data decoding is performed by the Weapon class directly. 
         Every time a piece of data is decoded the decoder seeker is incremented. */
-        var dataExtractor = new DataExtractor(buffer);
+        var dataExtractor = new DataExtractor(buffer, DATA_PROTOCOL);
 
         var updateTime = Number(dataExtractor.extractUInt64());
 
@@ -75,8 +75,8 @@ export class WeaponsManager {
                     this.addWeapon(ID, category);
                 }
                 else {
-                    /* Inconsistent data, we need to wait for a refresh */
-                    return updateTime;
+                    /* Inconsistent data, request a full refresh */
+                    return 0;
                 }
             }
             /* Update the data of the weapon */
@@ -21,6 +21,17 @@ Olympus.unitIndex = 0			-- Counter used to spread the computational load of data
 Olympus.unitStep = 50			-- Max number of units that get updated each cycle
 Olympus.units = {}				-- Table holding references to all the currently existing units
 Olympus.unitsInitialLife = {}	-- getLife0 returns 0 for ships, so we need to store the initial life of units
+Olympus.unitsLastLat = {}		-- Last known latitude of units, used to compute the track angle
+Olympus.unitsLastLng = {}		-- Last known longitude of units, used to compute the track angle
+
+-- If true, the units data is sent to the .dll as a single flat array instead of a nested table per unit. This avoids most of the table allocations.
+-- Each record is laid out as ID, N, followed by N fields. N = 0 means the unit no longer exists. Otherwise the fields are:
+-- category, name, coalitionID, lat, lng, alt, heading, track, speed, horizontalVelocity, verticalVelocity, isAlive,
+-- unitName, groupName, isHuman, hasTask, fuel, health, ammo count, (count, displayName, guidance, category, missileCategory) x ammo count,
+-- contacts count, (ID, detection method code) x contacts count
+-- This must be kept in sync with PackedUnitField in datatypes.h
+Olympus.packedUnitsData = false
+Olympus.detectionMethodCodes = {VISUAL = 1, OPTIC = 2, RADAR = 4, IRST = 8, RWR = 16, DLINK = 32}
 
 Olympus.weaponIndex = 0			-- Counter used to spread the computational load of data retrievial from DCS			
 Olympus.weaponStep = 50			-- Max number of weapons that get updated each cycle
@@ -960,6 +971,19 @@ function Olympus.setOnOff(groupName, onOff)
 	end
 end
 
+-- Run a batch of commands sent by the .dll as a single table, see SCHEDULER_DISPATCH_BATCH in defines.h. Each command is an array holding the
+-- function followed by its arguments. The arguments may contain nil values, so the array length is taken from table.maxn. The batch stops at the
+-- first command raising an error and returns its index, or 0 if all the commands ran: the .dll then sends the commands after it again, so that no
+-- command runs twice. The table is compiled as a whole: a malformed entry fails the whole batch before any command runs
+function Olympus.dispatch(batch)
+	for index, command in ipairs(batch) do
+		if not Olympus.protectedCall(unpack(command, 1, table.maxn(command))) then
+			return index
+		end
+	end
+	return 0
+end
+
 function getUnitDescription(unit) 
 	return unit:getDescr()
 end
@@ -968,6 +992,23 @@ end
 function Olympus.setUnitsData(arg, time)
 	-- Units data
 	local units = {}
+	local packed = {}
+	local packedSize = 0
+	local packedUnitsData = Olympus.packedUnitsData
+
+	-- Flag a unit as no longer existing
+	local function removeUnit(ID)
+		if packedUnitsData then
+			packed[packedSize + 1] = ID
+			packed[packedSize + 2] = 0
+			packedSize = packedSize + 2
+		else
+			units[ID] = {isAlive = false}
+		end
+		Olympus.units[ID] = nil
+		Olympus.unitsLastLat[ID] = nil
+		Olympus.unitsLastLng[ID] = nil
+	end
 	
 	local startIndex = Olympus.unitIndex
 	local endIndex = startIndex + Olympus.unitStep
@@ -977,86 +1018,63 @@ function Olympus.setUnitsData(arg, time)
 		-- Only the indexes between startIndex and endIndex are handled. This is a simple way to spread the update load over many cycles
 		if index > startIndex then
 			if unit ~= nil and unit:isExist() then
-				local table = {}	
+				local category = nil
 
 				-- Get the object category in Olympus name
 				local objectCategory = Object.getCategory(unit)
 				if objectCategory == Object.Category.UNIT then
 					if unit:getDesc().category == Unit.Category.AIRPLANE then
-						table["category"] = "Aircraft"
+						category = "Aircraft"
 					elseif unit:getDesc().category == Unit.Category.HELICOPTER then
-						table["category"] = "Helicopter"
+						category = "Helicopter"
 					elseif unit:getDesc().category == Unit.Category.GROUND_UNIT then
-						table["category"] = "GroundUnit"
+						category = "GroundUnit"
 					elseif unit:getDesc().category == Unit.Category.SHIP then
-						table["category"] = "NavyUnit"
+						category = "NavyUnit"
 					elseif Olympus.modsList ~= nil and Olympus.modsList[unit:getDesc().typeName] ~= nil then
-						table["category"] = Olympus.modsList[unit:getDesc().typeName]
+						category = Olympus.modsList[unit:getDesc().typeName]
 					end
 				else
 					local status, description = pcall(getUnitDescription, unit)
 					if status and Olympus.modsList ~= nil and Olympus.modsList[description.typeName] ~= nil then
-						table["category"] = Olympus.modsList[description.typeName]
+						category = Olympus.modsList[description.typeName]
 					else
-						units[ID] = {isAlive = false}
-						Olympus.units[ID] = nil
+						removeUnit(ID)
 					end
 				end
 
 				-- If the category is handled by Olympus, get the data
-				if table["category"] ~= nil then
+				if category ~= nil then
 					-- Compute unit position and heading
 					local lat, lng, alt = coord.LOtoLL(unit:getPoint())
 					local position = unit:getPosition()
 					local heading = math.atan2( position.x.z, position.x.x )
 					local velocity = unit:getVelocity();
-					
-					-- Fill the data table
-					table["name"] = unit:getTypeName()
-					table["coalitionID"] = unit:getCoalition()
-					table["position"] = {}
-					table["position"]["lat"] = lat 
-					table["position"]["lng"] = lng 
-					table["position"]["alt"] = alt
-					table["speed"] = mist.vec.mag(velocity)
-					table["horizontalVelocity"] =  math.sqrt(velocity.x * velocity.x + velocity.z * velocity.z)
-					table["verticalVelocity"] = velocity.y
-					table["heading"] = heading 
+					local typeName = unit:getTypeName()
+					local horizontalVelocity = math.sqrt(velocity.x * velocity.x + velocity.z * velocity.z)
 
 					-- Track angles are wrong because of weird reference systems, approximate it using latitude and longitude differences
-					if (table["horizontalVelocity"] > 1) then
-						if Olympus.unitsData["units"] ~= nil and Olympus.unitsData["units"][ID] ~= nil and Olympus.unitsData["units"][ID]["position"] ~= nil and Olympus.unitsData["units"][ID]["position"]["lat"] ~= nil and Olympus.unitsData["units"][ID]["position"]["lng"] ~= nil then
-							local latDifference = lat - Olympus.unitsData["units"][ID]["position"]["lat"]
-							local lngDifference = lng - Olympus.unitsData["units"][ID]["position"]["lng"]
-							table["track"] = math.atan2(lngDifference * math.cos(lat / 57.29577), latDifference)
+					local track = heading
+					if (horizontalVelocity > 1) then
+						local lastLat = Olympus.unitsLastLat[ID]
+						local lastLng = Olympus.unitsLastLng[ID]
+						if lastLat ~= nil and lastLng ~= nil then
+							local latDifference = lat - lastLat
+							local lngDifference = lng - lastLng
+							track = math.atan2(lngDifference * math.cos(lat / 57.29577), latDifference)
 						else
-							table["track"] = math.atan2(velocity.z, velocity.x)
+							track = math.atan2(velocity.z, velocity.x)
 						end
-					else
-						table["track"] = table["heading"]
 					end
+					Olympus.unitsLastLat[ID] = lat
+					Olympus.unitsLastLng[ID] = lng
 
-					table["isAlive"] = unit:isExist() and unit:isActive() and unit:getLife() >= 1
+					local isAlive = unit:isExist() and unit:isActive() and unit:getLife() >= 1
 					
 					local group = unit:getGroup()
 					if group ~= nil then
 						local controller = group:getController()
 						if controller ~= nil then
-							-- Get the targets detected by the unit controller
-							local contacts = {}
-							local unitController = unit:getController()
-							if unitController ~= nil then
-								for det, enum in pairs(Controller.Detection) do
-									local controllerTargets = unitController:getDetectedTargets(enum)
-									for i, target in ipairs(controllerTargets) do
-										if target ~= nil and target.object ~= nil and target.visible then
-											target["detectionMethod"] = det
-											contacts[#contacts + 1] = target
-										end
-									end
-								end
-							end
-							
 							-- getLife0 does not seem to work for ships, so we need to keep a reference to the initial life of the unit
 							if Olympus.unitsInitialLife[ID] == nil then
 								Olympus.unitsInitialLife[ID] = unit:getLife()
@@ -1067,20 +1085,118 @@ function Olympus.setUnitsData(arg, time)
 							if Olympus.unitsInitialLife[ID] ~= nil then
 								initialLife = Olympus.unitsInitialLife[ID]
 							end
-							
-							table["country"] = unit:getCountry()
+
+							local unitName = unit:getName()
 							if unit:getPlayerName() ~= nil then
-								table["unitName"] = unit:getPlayerName()
+								unitName = unit:getPlayerName()
+							end
+							local ammo = unit:getAmmo()
+							local unitController = unit:getController()
+
+							if packedUnitsData then
+								-- Append the unit record to the packed array, see Olympus.packedUnitsData for the layout. Nil values must never be written, or the array length becomes undefined
+								local recordStart = packedSize
+								packed[recordStart + 1] = ID
+								packed[recordStart + 3] = category
+								packed[recordStart + 4] = typeName
+								packed[recordStart + 5] = unit:getCoalition()
+								packed[recordStart + 6] = lat
+								packed[recordStart + 7] = lng
+								packed[recordStart + 8] = alt
+								packed[recordStart + 9] = heading
+								packed[recordStart + 10] = track
+								packed[recordStart + 11] = mist.vec.mag(velocity)
+								packed[recordStart + 12] = horizontalVelocity
+								packed[recordStart + 13] = velocity.y
+								packed[recordStart + 14] = isAlive
+								packed[recordStart + 15] = unitName
+								packed[recordStart + 16] = group:getName()
+								packed[recordStart + 17] = (unit:getPlayerName() ~= nil)
+								packed[recordStart + 18] = controller:hasTask()
+								packed[recordStart + 19] = unit:getFuel()
+								packed[recordStart + 20] = unit:getLife() / initialLife * 100
+								packedSize = recordStart + 21
+
+								-- Ammo, as a count followed by the flattened items
+								local ammoCount = 0
+								if ammo ~= nil then
+									ammoCount = #ammo
+								end
+								packed[packedSize] = ammoCount
+								for i = 1, ammoCount do
+									local desc = ammo[i].desc or {}
+									packed[packedSize + 1] = ammo[i].count or 0
+									packed[packedSize + 2] = desc.displayName or ""
+									packed[packedSize + 3] = desc.guidance or 0
+									packed[packedSize + 4] = desc.category or 0
+									packed[packedSize + 5] = desc.missileCategory or 0
+									packedSize = packedSize + 5
+								end
+
+								-- Contacts, as a count followed by the flattened items. The count is written once all the contacts are known
+								local contactsCountIndex = packedSize + 1
+								local contactsCount = 0
+								packed[contactsCountIndex] = 0
+								packedSize = contactsCountIndex
+								if unitController ~= nil then
+									for det, enum in pairs(Controller.Detection) do
+										local controllerTargets = unitController:getDetectedTargets(enum)
+										for i, target in ipairs(controllerTargets) do
+											if target ~= nil and target.object ~= nil and target.visible then
+												packed[packedSize + 1] = target.object.id_ or 0
+												packed[packedSize + 2] = Olympus.detectionMethodCodes[det] or 0
+												packedSize = packedSize + 2
+												contactsCount = contactsCount + 1
+											end
+										end
+									end
+								end
+								packed[contactsCountIndex] = contactsCount
+
+								-- Record length, i.e. the number of fields following it
+								packed[recordStart + 2] = packedSize - recordStart - 2
 							else
-								table["unitName"] = unit:getName()
+								-- Get the targets detected by the unit controller
+								local contacts = {}
+								if unitController ~= nil then
+									for det, enum in pairs(Controller.Detection) do
+										local controllerTargets = unitController:getDetectedTargets(enum)
+										for i, target in ipairs(controllerTargets) do
+											if target ~= nil and target.object ~= nil and target.visible then
+												target["detectionMethod"] = det
+												contacts[#contacts + 1] = target
+											end
+										end
+									end
+								end
+
+								-- Fill the data table
+								local table = {}
+								table["category"] = category
+								table["name"] = typeName
+								table["coalitionID"] = unit:getCoalition()
+								table["position"] = {}
+								table["position"]["lat"] = lat 
+								table["position"]["lng"] = lng 
+								table["position"]["alt"] = alt
+								table["speed"] = mist.vec.mag(velocity)
+								table["horizontalVelocity"] = horizontalVelocity
+								table["verticalVelocity"] = velocity.y
+								table["heading"] = heading 
+								table["track"] = track
+								table["isAlive"] = isAlive
+								table["country"] = unit:getCountry()
+								table["unitName"] = unitName
+								table["groupName"] = group:getName()
+								table["isHuman"] = (unit:getPlayerName() ~= nil)
+								table["hasTask"] = controller:hasTask()
+								table["ammo"] = ammo --TODO remove a lot of stuff we don't really need
+								table["fuel"] = unit:getFuel()
+								table["health"] = unit:getLife() / initialLife * 100
+								table["contacts"] = contacts
+
+								units[ID] = table
 							end
-							table["groupName"] = group:getName()
-							table["isHuman"] = (unit:getPlayerName() ~= nil)
-							table["hasTask"] = controller:hasTask()
-							table["ammo"] = unit:getAmmo() --TODO remove a lot of stuff we don't really need
-							table["fuel"] = unit:getFuel()
-							table["health"] = unit:getLife() / initialLife * 100
-							table["contacts"] = contacts
 
 							local name = unit:getName()
 
@@ -1098,23 +1214,23 @@ function Olympus.setUnitsData(arg, time)
 									local spawnTable = {}
 									spawnTable.units = {
 										[1] = {
-											["unitType"] = table["name"],
-											["lat"] = table["position"]["lat"],
-											["lng"] = table["position"]["lng"],
-											["alt"] = table["position"]["alt"],
+											["unitType"] = typeName,
+											["lat"] = lat,
+											["lng"] = lng,
+											["alt"] = alt,
 											["payload"] = payload,
 											["liveryID"] = mist.DBs.unitsByName[name]["livery_id"]
 										}
 									}
 
 									-- Generate the units table as per DCS requirements
-									if table["category"] == 'Aircraft' then
+									if category == 'Aircraft' then
 										unitsTable = Olympus.generateAirUnitsTable(spawnTable.units)
-									elseif table["category"] == 'Helicopter' then
+									elseif category == 'Helicopter' then
 										unitsTable = Olympus.generateAirUnitsTable(spawnTable.units)
-									elseif table["category"] == 'GroundUnit' then
+									elseif category == 'GroundUnit' then
 										unitsTable = Olympus.generateGroundUnitsTable(spawnTable.units)
-									elseif table["category"] == 'NavyUnit' then
+									elseif category == 'NavyUnit' then
 										unitsTable = Olympus.generateNavyUnitsTable(spawnTable.units)
 									end
 
@@ -1131,23 +1247,19 @@ function Olympus.setUnitsData(arg, time)
 							if Olympus.cloneDatabase[name] ~= nil then
 								Olympus.cloneDatabase[name]["ID"] = ID
 								Olympus.cloneDatabase[name]["category"] = unit:getDesc().category
-								Olympus.cloneDatabase[name]["heading"] = table["heading"]
+								Olympus.cloneDatabase[name]["heading"] = heading
 								Olympus.cloneDatabase[name]["alt"] = alt
 								Olympus.cloneDatabase[name]["country"] = unit:getCountry()
 							end
-
-							units[ID] = table
 						end
 					else
 						-- If the unit reference is nil it means the unit no longer exits
-						units[ID] = {isAlive = false}
-						Olympus.units[ID] = nil
+						removeUnit(ID)
 					end
 				end
 			else
 				-- If the unit reference is nil it means the unit no longer exits
-				units[ID] = {isAlive = false}
-				Olympus.units[ID] = nil
+				removeUnit(ID)
 			end
 		end
 		if index >= endIndex then
@@ -1163,7 +1275,13 @@ function Olympus.setUnitsData(arg, time)
 	end
 	
 	-- Assemble unitsData table
-	Olympus.unitsData["units"] = units
+	if packedUnitsData then
+		Olympus.unitsData["units"] = nil
+		Olympus.unitsData["packed"] = packed
+	else
+		Olympus.unitsData["units"] = units
+		Olympus.unitsData["packed"] = nil
+	end
 
 	Olympus.OlympusDLL.setUnitsData()
 	return time + 0.05